@@ -9,6 +9,7 @@
 
 #include <stdexcept>
 #include <iostream>
+#include <sstream>
 #include <cmath>
 #include <algorithm>
 
@@ -24,25 +25,208 @@ using std::runtime_error;
 using std::vector;
 using namespace vector_helper;
 
+/**
+ * Visits all blocks of cells nodes dividing grid, keeping the one 
+ * with smallest surface towards other blocks
+ * @param cells cells still to be placed
+ * @param dd current direction
+ * @param block block being built
+ * @param grid grid dimensions
+ * @param best best block found ( empty: none yet )
+ * @param bestSurface surface of best block
+ */
+static void visitBlocks( int cells, unsigned int dd, vector<int>& block,
+    const vector<int>& grid, vector<int>& best, long& bestSurface ){
+
+  if ( dd == block.size() ){
+    if ( cells != 1 )
+      return;
+    long volume = prod( block ), surface = 0;
+    for ( unsigned int ii = 0; ii < block.size(); ++ii )
+      if ( block[ii] < grid[ii] )
+        surface += 2 * volume / block[ii];
+    if ( best.empty() || surface < bestSurface ){
+      best = block;
+      bestSurface = surface;
+    }
+    return;
+  }
+
+  for ( int factor = 1; factor <= cells; ++factor ){
+    if ( cells % factor || grid[dd] % factor )
+      continue;
+    block[dd] = factor;
+    visitBlocks( cells / factor, dd + 1, block, grid, best, bestSurface );
+  }
+}
+
+/**
+ * Evaluates the rank in grid of current node, so that nodes 
+ * sharing memory hold compact blocks of the grid
+ * @param comm original communicator
+ * @param grid grid dimensions
+ * @param block block of grid for each node ( empty: evaluated here )
+ * @return rank in grid ( C order ), MPI_UNDEFINED if not in grid
+ *
+ * Nodes are taken in order of their lowest rank, and ranks of each node
+ * are consecutive; this sequence is cut in blocks. An empty block is 
+ * chosen only when all shared memory nodes have the same size and a 
+ * block of that size tiles the grid, with minimal surface; otherwise 
+ * nodes get consecutive ranks of the grid.
+ */
+static int nodeAwareRank( MPI_Comm comm, const vector<int>& grid,
+    const vector<int>& block ){
+
+  int rank, size;
+  mpiSafeCall( MPI_Comm_rank( comm, &rank ) );
+  mpiSafeCall( MPI_Comm_size( comm, &size ) );
+
+  MPI_Comm node;
+  mpiSafeCall( MPI_Comm_split_type( comm, MPI_COMM_TYPE_SHARED, rank,
+        MPI_INFO_NULL, &node ) );
+  int info[3]; // leader, rank in node, node size
+  info[0] = rank;
+  mpiSafeCall( MPI_Comm_rank( node, &info[1] ) );
+  mpiSafeCall( MPI_Comm_size( node, &info[2] ) );
+  mpiSafeCall( MPI_Bcast( &info[0], 1, MPI_INT, 0, node ) );
+  mpiSafeCall( MPI_Comm_free( &node ) );
+
+  vector<int> all( 3 * size );
+  mpiSafeCall( MPI_Allgather( info, 3, MPI_INT, &all[0], 3, MPI_INT, comm ) );
+
+  // nodes ordered by leader: index of my node, nodes before me
+  vector<int> leaders, sizes;
+  for ( int ii = 0; ii < size; ++ii )
+    if ( all[3*ii] == ii ){
+      leaders.push_back( ii );
+      sizes.push_back( all[3*ii+2] );
+    }
+  const int myNode = std::lower_bound( leaders.begin(), leaders.end(), info[0] ) 
+    - leaders.begin();
+
+  const int cells = prod( grid );
+  int sequence = info[1];
+  for ( int nn = 0; nn < myNode; ++nn )
+    sequence += sizes[nn];
+  if ( sequence >= cells )
+    return MPI_UNDEFINED;
+
+  vector<int> best( block );
+  if ( best.empty() ){
+    const int cores = sizes[0];
+    bool uniform = cells % cores == 0;
+    for ( unsigned int ii = 0; ii < sizes.size(); ++ii )
+      uniform = uniform && sizes[ii] == cores;
+
+    vector<int> candidate( grid.size() );
+    long bestSurface = 0;
+    if ( uniform )
+      visitBlocks( cores, 0, candidate, grid, best, bestSurface );
+
+    // consecutive ranks on each node
+    if ( best.empty() )
+      return sequence;
+  }
+
+  // block of my node, then my cell inside block ( both C order )
+  const int D = grid.size();
+  const int cores = prod( best );
+  vector<int> coords( D );
+  int blockIndex = sequence / cores, cellIndex = sequence % cores;
+  for ( int dd = D - 1; dd >= 0; --dd ){
+    int blocks = grid[dd] / best[dd];
+    coords[dd] = ( blockIndex % blocks ) * best[dd] + cellIndex % best[dd];
+    blockIndex /= blocks;
+    cellIndex /= best[dd];
+  }
+
+  int position = 0;
+  for ( int dd = 0; dd < D; ++dd )
+    position = position * grid[dd] + coords[dd];
+  return position;
+}
+
+/**
+ * Multiplies node grid and core grid
+ * @param nodeDims grid of nodes
+ * @param coreDims grid of cores in each node
+ * @return overall grid
+ */
+static vector<int> twoLevelDims( const vector<int>& nodeDims, 
+    const vector<int>& coreDims ){
+
+  if ( nodeDims.size() != coreDims.size() )
+    throw runtime_error("CartSplitter: node and core dims size mismatch");
+
+  vector<int> dims( nodeDims.size() );
+  for ( unsigned int dd = 0; dd < dims.size(); ++dd ){
+    if ( nodeDims[dd] < 1 || coreDims[dd] < 1 )
+      throw runtime_error("CartSplitter: node and core dims must be positive");
+    dims[dd] = nodeDims[dd] * coreDims[dd];
+  }
+  return dims;
+}
+
 CartSplitter::CartSplitter( const std::vector<int>& dims,
                   const std::vector<int>& periodicity,
                   MPI_Comm origComm, int reorder ) 
   : _dims( dims ), _periodicity( periodicity ), _comm(0), _reorder( reorder ),
   _inGrid(false), _cartRank( MPI_PROC_NULL ), _cartSize(0), _coordinates(0),
-  _directions( _dims.size() ), _destNeighbours(0), _srcNeighbours(0)
+  _directions( _dims.size() ), _destNeighbours(0), _srcNeighbours(0),
+  _faceDirections(0), _graphComm( MPI_COMM_NULL ), _faceGraphComm( MPI_COMM_NULL ),
+  _nodeComm( MPI_COMM_NULL ), _nodeWin( MPI_WIN_NULL ), _nodeWinSize(0), _nodeBase(0),
+  _destNodeNeighbours(0), _srcNodeNeighbours(0), _nodeLeaders(0),
+  _coreDims(0), _blockComm( MPI_COMM_NULL ), 
+  _destBlockNeighbours(0), _srcBlockNeighbours(0),
+  _pool(0), _threadMultiple(false)
+{
+  init( origComm );
+}
+
+CartSplitter::CartSplitter( const std::vector<int>& nodeDims,
+                  const std::vector<int>& coreDims,
+                  const std::vector<int>& periodicity,
+                  MPI_Comm origComm ) 
+  : _dims( twoLevelDims( nodeDims, coreDims ) ), _periodicity( periodicity ), 
+  _comm(0), _reorder( 0 ),
+  _inGrid(false), _cartRank( MPI_PROC_NULL ), _cartSize(0), _coordinates(0),
+  _directions( _dims.size() ), _destNeighbours(0), _srcNeighbours(0),
+  _faceDirections(0), _graphComm( MPI_COMM_NULL ), _faceGraphComm( MPI_COMM_NULL ),
+  _nodeComm( MPI_COMM_NULL ), _nodeWin( MPI_WIN_NULL ), _nodeWinSize(0), _nodeBase(0),
+  _destNodeNeighbours(0), _srcNodeNeighbours(0), _nodeLeaders(0),
+  _coreDims( coreDims ), _blockComm( MPI_COMM_NULL ), 
+  _destBlockNeighbours(0), _srcBlockNeighbours(0),
+  _pool(0), _threadMultiple(false)
 {
+  init( origComm );
+}
+
+void CartSplitter::init( MPI_Comm origComm ){
 
-  if ( dims.size() != periodicity.size() )
+  if ( _dims.size() != _periodicity.size() )
     throw runtime_error("CartSplitter: dims and periodicity size mismatch");
 
   int commSize;
   MPI_Comm_size( origComm, &commSize );
-  if( prod( dims.begin(), dims.end() ) > commSize )
+  if( prod( _dims.begin(), _dims.end() ) > commSize )
     throw runtime_error("CartSplitter: not enough nodes in original communicator");
  
   _comm = MPI_COMM_NULL;
 
-  mpiSafeCall( MPI_Cart_create( origComm, _dims.size(), 
+  if ( _reorder == NodeAware || !_coreDims.empty() ){
+    // ranks permuted so that nodes sharing memory are neighbours
+    int position = nodeAwareRank( origComm, _dims, _coreDims );
+    MPI_Comm permuted;
+    mpiSafeCall( MPI_Comm_split( origComm, 
+          position == MPI_UNDEFINED ? MPI_UNDEFINED : 0, position, &permuted ) );
+    if ( permuted != MPI_COMM_NULL ){
+      mpiSafeCall( MPI_Cart_create( permuted, _dims.size(), 
+            &_dims[0], &_periodicity[0], 0, &_comm ) );
+      mpiSafeCall( MPI_Comm_free( &permuted ) );
+    }
+  }
+  else
+    mpiSafeCall( MPI_Cart_create( origComm, _dims.size(), 
           &_dims[0], &_periodicity[0], _reorder, &_comm ) );
 
   _inGrid = _comm != MPI_COMM_NULL;
@@ -60,13 +244,108 @@ CartSplitter::CartSplitter( const std::vector<int>& dims,
       _srcNeighbours[ii] = getRankByOffset( -1 * _directions[ii] );
     } 
 
+    // faces: directions with a single non zero offset
+    _faceDirections = vector< int > ( 2 * _dims.size() );
+    for( int ii = 0; ii < Ndirs; ++ii ){
+      int nonZero = 0, dim = 0;
+      for( unsigned int dd = 0; dd < _dims.size(); ++dd )
+        if ( _directions[ii][dd] != 0 ){
+          ++nonZero;
+          dim = dd;
+        }
+      if ( nonZero == 1 )
+        _faceDirections[ 2*dim + ( _directions[ii][dim] > 0 ) ] = ii;
+    }
+
+    // neighbours sharing memory with current node
+    mpiSafeCall( MPI_Comm_split_type( _comm, MPI_COMM_TYPE_SHARED, _cartRank,
+          MPI_INFO_NULL, &_nodeComm ) );
+
+    MPI_Group cartGroup, nodeGroup;
+    mpiSafeCall( MPI_Comm_group( _comm, &cartGroup ) );
+    mpiSafeCall( MPI_Comm_group( _nodeComm, &nodeGroup ) );
+    _destNodeNeighbours = vector< int > ( Ndirs );
+    _srcNodeNeighbours = vector< int > ( Ndirs );
+    mpiSafeCall( MPI_Group_translate_ranks( cartGroup, Ndirs, &_destNeighbours[0],
+          nodeGroup, &_destNodeNeighbours[0] ) );
+    mpiSafeCall( MPI_Group_translate_ranks( cartGroup, Ndirs, &_srcNeighbours[0],
+          nodeGroup, &_srcNodeNeighbours[0] ) );
+    mpiSafeCall( MPI_Group_free( &nodeGroup ) );
+    mpiSafeCall( MPI_Group_free( &cartGroup ) );
+
+    // leader of each shared memory node: its lowest rank
+    int leader = _cartRank;
+    mpiSafeCall( MPI_Bcast( &leader, 1, MPI_INT, 0, _nodeComm ) );
+    _nodeLeaders = vector< int > ( _cartSize );
+    mpiSafeCall( MPI_Allgather( &leader, 1, MPI_INT, 
+          &_nodeLeaders[0], 1, MPI_INT, _comm ) );
+
+    // neighbours in the same block of a two level grid
+    if ( !_coreDims.empty() ){
+      int member;
+      blockPosition( _cartRank, leader, member );
+      mpiSafeCall( MPI_Comm_split( _comm, leader, member, &_blockComm ) );
+
+      _destBlockNeighbours = vector< int > ( Ndirs, MPI_UNDEFINED );
+      _srcBlockNeighbours = vector< int > ( Ndirs, MPI_UNDEFINED );
+      for( int ii = 0; ii < Ndirs; ++ii ){
+        int neighbourLeader;
+        if ( _destNeighbours[ii] != MPI_PROC_NULL ){
+          blockPosition( _destNeighbours[ii], neighbourLeader, member );
+          if ( neighbourLeader == leader )
+            _destBlockNeighbours[ii] = member;
+        }
+        if ( _srcNeighbours[ii] != MPI_PROC_NULL ){
+          blockPosition( _srcNeighbours[ii], neighbourLeader, member );
+          if ( neighbourLeader == leader )
+            _srcBlockNeighbours[ii] = member;
+        }
+      }
+    }
+  }
+}
+
+void CartSplitter::setHaloThreads( int threads ){
+  if ( threads < 1 )
+    throw runtime_error("CartSplitter::setHaloThreads() at least one thread needed");
+
+  int provided;
+  mpiSafeCall( MPI_Query_thread( &provided ) );
+  _threadMultiple = provided == MPI_THREAD_MULTIPLE;
+
+  delete _pool;
+  _pool = 0;
+  if ( threads > 1 )
+    _pool = new ThreadPool( threads );
+}
+
+void CartSplitter::blockPosition( int rank, int& leader, int& member ) const {
+  vector<int> coo = getCoordinates( rank ), first( coo );
+  member = 0;
+  for ( unsigned int dd = 0; dd < coo.size(); ++dd ){
+    first[dd] -= coo[dd] % _coreDims[dd];
+    member = member * _coreDims[dd] + coo[dd] % _coreDims[dd];
   }
+  leader = getRank( first );
 }
 
 CartSplitter::~CartSplitter( ) {
+  delete _pool;
   try {
-    if( _inGrid )
+    if( _inGrid ){
+      if ( _blockComm != MPI_COMM_NULL )
+        mpiSafeCall( MPI_Comm_free( &_blockComm ) );
+      if ( _nodeWin != MPI_WIN_NULL ){
+        mpiSafeCall( MPI_Win_unlock_all( _nodeWin ) );
+        mpiSafeCall( MPI_Win_free( &_nodeWin ) );
+      }
+      mpiSafeCall( MPI_Comm_free( &_nodeComm ) );
+      if ( _graphComm != MPI_COMM_NULL )
+        mpiSafeCall( MPI_Comm_free( &_graphComm ) );
+      if ( _faceGraphComm != MPI_COMM_NULL )
+        mpiSafeCall( MPI_Comm_free( &_faceGraphComm ) );
       mpiSafeCall( MPI_Comm_free( &_comm ) );
+    }
   } catch ( std::exception &e ){
         std::cerr << "Errors on CartSplitter dtor: " 
           << e.what() << std::endl;
@@ -74,6 +353,86 @@ CartSplitter::~CartSplitter( ) {
 
 } 
 
+/**
+ * Visits all factorizations of nodes in grid[dd:], keeping best one 
+ * @param nodes nodes still to be placed
+ * @param dd current direction
+ * @param grid grid being built
+ * @param dataDims sizes for each direction
+ * @param halo haloPre + haloPost for each direction
+ * @param best best grid found
+ * @param bestCost halo volume of best grid ( negative: none yet )
+ */
+static void visitGrids( int nodes, unsigned int dd, vector<int>& grid,
+    const vector<int>& dataDims, const vector<int>& halo,
+    vector<int>& best, double& bestCost ){
+
+  if ( dd + 1 == grid.size() ){
+    if ( nodes > dataDims[dd] )
+      return;
+    grid[dd] = nodes;
+
+    double extended = 1, internal = 1;
+    for ( unsigned int ii = 0; ii < grid.size(); ++ii ){
+      extended *= dataDims[ii] + grid[ii] * (double) halo[ii];
+      internal *= dataDims[ii];
+    }
+    double cost = extended - internal;
+
+    // equal cost: smaller spread between grid sizes
+    if ( bestCost < 0 || cost < bestCost || ( cost == bestCost 
+          && *std::max_element( grid.begin(), grid.end() ) 
+          - *std::min_element( grid.begin(), grid.end() ) 
+          < *std::max_element( best.begin(), best.end() ) 
+          - *std::min_element( best.begin(), best.end() ) ) ){
+      best = grid;
+      bestCost = cost;
+    }
+    return;
+  }
+
+  // decreasing factors, as MPI_Dims_create
+  for ( int factor = std::min( nodes, dataDims[dd] ); factor > 0; --factor ){
+    if ( nodes % factor )
+      continue;
+    grid[dd] = factor;
+    visitGrids( nodes / factor, dd + 1, grid, dataDims, halo, best, bestCost );
+  }
+}
+
+std::vector<int> CartSplitter::bestGridDims( int nodes, 
+    const std::vector<int>& dataDims,
+    const std::vector<int>& haloPre,
+    const std::vector<int>& haloPost ){
+
+  if ( nodes < 1 || dataDims.empty() || haloPre.size() != dataDims.size()
+      || haloPost.size() != dataDims.size() )
+    throw runtime_error("CartSplitter::bestGridDims() wrong parameters");
+
+  vector<int> halo( haloPre + haloPost );
+  vector<int> grid( dataDims.size() ), best;
+  double bestCost = -1;
+  visitGrids( nodes, 0, grid, dataDims, halo, best, bestCost );
+
+  if ( best.empty() )
+    throw runtime_error("CartSplitter::bestGridDims() more nodes than data elements");
+
+  return best;
+}
+
+CartSplitter* CartSplitter::createForData( const std::vector<int>& dataDims,
+    const std::vector<int>& periodicity,
+    const std::vector<int>& haloPre,
+    const std::vector<int>& haloPost,
+    MPI_Comm comm, int reorder ){
+
+  int commSize;
+  mpiSafeCall( MPI_Comm_size( comm, &commSize ) );
+
+  return new CartSplitter( bestGridDims( commSize, dataDims, haloPre, haloPost ),
+      periodicity, comm, reorder );
+}
+
 std::vector<int> CartSplitter::getCoordinates( int rank ) const {
   if ( !_inGrid )
     throw runtime_error(
@@ -124,7 +483,7 @@ int CartSplitter::getRankByOffset( const std::vector<int>& offset ) const {
   if ( offset.size() != _dims.size() )
     throw runtime_error(
         "CartSplitter::getRankByOffset() offset size mismatch");
- 
+
   std::vector<int> coords( _coordinates + offset );
  
   return getRank( coords );
@@ -135,17 +494,93 @@ void CartSplitter::evalDimsOffsets ( const std::vector<int>& dataDims,
                        std::vector< std::vector<int> >& localDims,
                        std::vector< std::vector<int> >& localOffset ) const{
 
+  evalDimsOffsets( dataDims, std::vector< std::vector<double> >( dataDims.size() ),
+      localDims, localOffset );
+
+}
+
+/**
+ * Splits n cells in parts blocks, balancing the sum of weights
+ * @param n number of cells
+ * @param parts number of blocks
+ * @param weights cost of each cell ( empty or all zero: uniform )
+ * @return first cell of each block, followed by n
+ */
+static vector<int> splitPoints( int n, int parts, const vector<double>& weights ){
+
+  vector<int> bounds( parts + 1, n );
+  bounds[0] = 0;
+
+  if ( !weights.empty() && (int) weights.size() != n )
+    throw runtime_error("CartSplitter::evalDimsOffsets() weights size mismatch");
+
+  vector<double> prefix( n + 1, 0.0 );
+  for ( unsigned int ii = 0; ii < weights.size(); ++ii ){
+    if ( weights[ii] < 0 )
+      throw runtime_error("CartSplitter::evalDimsOffsets() negative weight");
+    prefix[ii+1] = prefix[ii] + weights[ii];
+  }
+
+  // no weights ( or no cost at all ): uniform split
+  if ( prefix[n] == 0 ){
+    // floor division, reminder on first blocks
+    int tileSize = n / parts, reminder = n % parts;
+    for ( int pp = 1; pp < parts; ++pp )
+      bounds[pp] = pp * tileSize + std::min( pp, reminder );
+    return bounds;
+  }
+
+  // each cut closest to its share of total cost, at least a cell per block
+  for ( int pp = 1; pp < parts; ++pp ){
+    double target = prefix[n] * pp / parts;
+    int cut = std::lower_bound( prefix.begin(), prefix.end(), target ) - prefix.begin();
+    if ( cut > 0 && target - prefix[cut-1] < prefix[cut] - target )
+      --cut;
+    int lo = std::min( bounds[pp-1] + 1, n );
+    int hi = std::max( n - ( parts - pp ), lo );
+    bounds[pp] = std::max( lo, std::min( cut, hi ) );
+  }
+
+  return bounds;
+}
+
+void CartSplitter::evalDimsOffsets ( const std::vector<int>& dataDims, 
+                       const std::vector< std::vector<double> >& weights,
+                       std::vector< std::vector<int> >& localDims,
+                       std::vector< std::vector<int> >& localOffset ) const{
+
   if ( !_inGrid )
     throw runtime_error(
         "CartSplitter::evalDimsOffsets() called in node outside topology");
 
   int D = dataDims.size();
+  if ( (int) weights.size() != D )
+    throw runtime_error("CartSplitter::evalDimsOffsets() weights size mismatch");
+
+  // split points on each dimension: tensor product of 1-d splits
+  vector< vector<int> > bounds( D );
+  for ( int dd = 0; dd < D; ++dd ){
+    if ( _coreDims.empty() ){
+      bounds[dd] = splitPoints( dataDims[dd], _dims[dd], weights[dd] );
+      continue;
+    }
 
-  // floor division
-  std::vector<int> tileSize = dataDims / _dims;
-
-  // rem
-  std::vector<int> reminder = dataDims % _dims;
+    // two level grid: node blocks, then cores of each node
+    const int cores = _coreDims[dd];
+    vector<int> nodeBounds = splitPoints( dataDims[dd], _dims[dd] / cores, 
+        weights[dd] );
+    bounds[dd].assign( 1, 0 );
+    for ( unsigned int nn = 0; nn + 1 < nodeBounds.size(); ++nn ){
+      const int first = nodeBounds[nn], n = nodeBounds[nn+1] - first;
+      vector<double> nodeWeights;
+      if ( !weights[dd].empty() )
+        nodeWeights.assign( weights[dd].begin() + first, 
+            weights[dd].begin() + first + n );
+      vector<int> coreBounds = splitPoints( n, cores, nodeWeights );
+      for ( int cc = 1; cc <= cores; ++cc )
+        bounds[dd].push_back( first + coreBounds[cc] );
+    }
+  }
 
   localDims.clear(); localDims.resize( _cartSize );
   localOffset.clear(); localOffset.resize( _cartSize );
@@ -156,9 +591,8 @@ void CartSplitter::evalDimsOffsets ( const std::vector<int>& dataDims,
     localOffset[node].clear(); localOffset[node].resize( D );
 
     for ( int dd = 0; dd < D; ++dd ) {
-      localDims[node][dd] = tileSize[dd] + ( coo[dd] < reminder[dd] );      
-      localOffset[node][dd] 
-        = coo[dd] * tileSize[dd] + (coo[dd] < reminder[dd] ? coo[dd] : reminder[dd]);
+      localOffset[node][dd] = bounds[dd][ coo[dd] ];
+      localDims[node][dd] = bounds[dd][ coo[dd] + 1 ] - bounds[dd][ coo[dd] ];
     }    
     
   }
@@ -167,6 +601,131 @@ void CartSplitter::evalDimsOffsets ( const std::vector<int>& dataDims,
 }
 
 
+void CartSplitter::haloUpdateEnd( HaloRequest& request ){
+
+  if ( !request._requests.empty() ){
+    mpiSafeCall( MPI_Waitall( request._requests.size(), &request._requests[0],
+          MPI_STATUSES_IGNORE ) );
+    request._requests.clear();
+  }
+
+  if ( request._completion ){
+    request._completion( request._localData, request._dd );
+    request._completion = 0;
+  }
+
+}
+
+void CartSplitter::checkBufferSize( size_t size, size_t required, 
+    const char * caller ) const {
+  if ( size < required ){
+    std::stringstream ss;
+    ss << "CartSplitter::" << caller << "() buffer holds " << size 
+      << " values, " << required << " required";
+    throw runtime_error( ss.str() );
+  }
+}
+
+void CartSplitter::initFieldsExchange( const std::vector< MPI_Aint >& addresses,
+    MPI_Datatype sendType, MPI_Datatype recvType, 
+    int dest, int src, HaloPlan * plan ){
+
+  // no fields, nothing to exchange
+  if ( addresses.empty() )
+    return;
+
+  const int N = addresses.size();
+  std::vector< int > blocklengths( N, 1 );
+  std::vector< MPI_Datatype > types( N );
+
+  if ( src != MPI_PROC_NULL ){
+    int recvcnt = 0;
+    MPI_Datatype recvtype = MPI_INT;
+    if ( recvType != 0 ){
+      types.assign( N, recvType );
+      mpiSafeCall( MPI_Type_create_struct( N, &blocklengths[0], &addresses[0],
+            &types[0], &recvtype ) );
+      mpiSafeCall( MPI_Type_commit( &recvtype ) );
+      plan->_types.push_back( recvtype );
+      recvcnt = 1;
+    }
+
+    MPI_Request req;
+    mpiSafeCall( MPI_Recv_init( MPI_BOTTOM, recvcnt, recvtype, 
+          src, 11, _comm, &req ) );
+    plan->_requests.push_back( req );
+  }
+
+  if ( dest != MPI_PROC_NULL ){
+    int sendcnt = 0;
+    MPI_Datatype sendtype = MPI_INT;
+    if ( sendType != 0 ){
+      types.assign( N, sendType );
+      mpiSafeCall( MPI_Type_create_struct( N, &blocklengths[0], &addresses[0],
+            &types[0], &sendtype ) );
+      mpiSafeCall( MPI_Type_commit( &sendtype ) );
+      plan->_types.push_back( sendtype );
+      sendcnt = 1;
+    }
+
+    MPI_Request req;
+    mpiSafeCall( MPI_Send_init( MPI_BOTTOM, sendcnt, sendtype, 
+          dest, 11, _comm, &req ) );
+    plan->_requests.push_back( req );
+  }
+
+}
+
+MPI_Comm CartSplitter::graphComm( StencilShape::type stencil ){
+
+  const bool faces = stencil == StencilShape::Star;
+  MPI_Comm& comm = faces ? _faceGraphComm : _graphComm;
+  if ( comm != MPI_COMM_NULL )
+    return comm;
+
+  // graph of first neighbours in stencil, in direction order 
+  vector<int> sources, destinations;
+  for( unsigned int ii = 0; ii < _directions.size(); ++ii ){
+    if ( faces && std::count( _directions[ii].begin(), _directions[ii].end(), 0 ) 
+        != (int) _dims.size() - 1 )
+      continue;
+    if ( _srcNeighbours[ii] != MPI_PROC_NULL )
+      sources.push_back( _srcNeighbours[ii] );
+    if ( _destNeighbours[ii] != MPI_PROC_NULL )
+      destinations.push_back( _destNeighbours[ii] );
+  }
+
+  mpiSafeCall( MPI_Dist_graph_create_adjacent( _comm, 
+        sources.size(), sources.data(), MPI_UNWEIGHTED,
+        destinations.size(), destinations.data(), MPI_UNWEIGHTED,
+        MPI_INFO_NULL, 0, &comm ) );
+
+  return comm;
+}
+
+void CartSplitter::reserveNodeWindow( MPI_Aint bytes ){
+
+  if ( bytes <= _nodeWinSize )
+    return;
+
+  if ( _nodeWin != MPI_WIN_NULL ){
+    mpiSafeCall( MPI_Win_unlock_all( _nodeWin ) );
+    mpiSafeCall( MPI_Win_free( &_nodeWin ) );
+  }
+
+  // leader is rank 0 in node comm
+  MPI_Aint size = _nodeLeaders[_cartRank] == _cartRank ? bytes : 0;
+  mpiSafeCall( MPI_Win_allocate_shared( size, 1, MPI_INFO_NULL, 
+        _nodeComm, &_nodeBase, &_nodeWin ) );
+  mpiSafeCall( MPI_Win_lock_all( MPI_MODE_NOCHECK, _nodeWin ) );
+
+  MPI_Aint leaderSize;
+  int dispUnit;
+  mpiSafeCall( MPI_Win_shared_query( _nodeWin, 0, &leaderSize, &dispUnit, 
+        &_nodeBase ) );
+  _nodeWinSize = bytes;
+}
+
 void CartSplitter::fillDirections( int d ){
 
   // 0 must be last item in alphabet
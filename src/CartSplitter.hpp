@@ -11,10 +11,17 @@
 #define CARTSPLITTER_HPP 
 
 #include <vector>
+#include <string>
 #include <stdexcept>
+#include <algorithm>
 
 #include "vector_helper.hpp"
 #include "DistributedDescription.hpp"
+#include "HaloRequest.hpp"
+#include "HaloPlan.hpp"
+#include "SharedHalo.hpp"
+#include "RmaHalo.hpp"
+#include "ThreadPool.hpp"
 
 #include "mpi.h"
 /*
@@ -29,6 +36,23 @@ static const MPI_Datatype mpi_datatype;
 template <typename T>
 class DistributedDescription;
 
+/**
+ * Halo bytes sent by all nodes in cart, split by destination
+ */
+struct HaloLocality {
+  long long intraNode;  //!< bytes sent to nodes sharing memory
+  long long interNode;  //!< bytes sent to other nodes
+
+  /**
+   * Returns the fraction of halo bytes staying on node
+   * @return intraNode / ( intraNode + interNode ), 0 if no halo
+   */
+  double intraFraction() const {
+    long long total = intraNode + interNode;
+    return total ? double( intraNode ) / total : 0.;
+  }
+};
+
 /**
  *  Cartesian Topology Splitter
  */
@@ -37,7 +61,7 @@ class CartSplitter {
     std::vector<int> _dims;         //!< dimensions
     std::vector<int> _periodicity;  //!< periodicity ( 1=periodic 0=not periodic)
     MPI_Comm _comm;                 //!< communicator with cartesian topology
-    int _reorder;                   //!< MPI can reorder nodes in new comm
+    int _reorder;                   //!< MPI can reorder nodes in new comm ( or NodeAware )
     bool _inGrid;                   //!< true if I'm in the grid
     int _cartRank;                  //!< rank of current node in cart comm
     int _cartSize;                  //!< size of current cart comm
@@ -55,6 +79,27 @@ class CartSplitter {
     std::vector< std::vector<int> > _directions; //!< directions to reach first neigh.
     std::vector< int > _destNeighbours; 
     std::vector< int > _srcNeighbours;
+    std::vector< int > _faceDirections; //!< index in _directions of -1/+1 on each dim
+
+    MPI_Comm _graphComm;     //!< distributed graph comm over first neighbours ( see graphComm )
+    MPI_Comm _faceGraphComm; //!< distributed graph comm over face neighbours ( see graphComm )
+
+    MPI_Comm _nodeComm;  //!< nodes in cart sharing memory with current node
+    MPI_Win _nodeWin;    //!< shared buffer of CollectiveMode::Hierarchical ( see reserveNodeWindow )
+    MPI_Aint _nodeWinSize; //!< bytes of node buffer in _nodeWin ( allocated by node leader )
+    void * _nodeBase;    //!< first byte of node leader segment
+    std::vector< int > _destNodeNeighbours; //!< rank in _nodeComm (MPI_UNDEFINED if not on node)
+    std::vector< int > _srcNodeNeighbours;  //!< rank in _nodeComm (MPI_UNDEFINED if not on node)
+    std::vector< int > _nodeLeaders; //!< for each node in cart, lowest rank on its shared memory node
+
+    // two level grid: blocks of _coreDims nodes, one block for each node group
+    std::vector<int> _coreDims; //!< block dimensions ( empty: single level grid )
+    MPI_Comm _blockComm;        //!< nodes in current block, leader is rank 0
+    std::vector< int > _destBlockNeighbours; //!< rank in _blockComm (MPI_UNDEFINED if not in block)
+    std::vector< int > _srcBlockNeighbours;  //!< rank in _blockComm (MPI_UNDEFINED if not in block)
+
+    ThreadPool * _pool;      //!< threads for HaloEngine::Threaded ( 0: caller only )
+    bool _threadMultiple;    //!< MPI calls allowed from any thread of _pool
 
     CartSplitter ( const CartSplitter& );
     CartSplitter& operator= ( const CartSplitter& );
@@ -84,17 +129,49 @@ class CartSplitter {
      */
     void fillDirections( int d );
 
+    /**
+     * Creates cart communicator and neighbours ( called by ctors )
+     * @param origComm original communicator
+     */
+    void init( MPI_Comm origComm );
+
+    /**
+     * Finds block of a node in a two level grid
+     * @param rank rank of node
+     * @param leader rank of block leader ( first node of block )
+     * @param member rank of node in block ( C order )
+     */
+    void blockPosition( int rank, int& leader, int& member ) const;
+
+    /**
+     * Returns the graph communicator of a stencil, creating it on 
+     * first call ( collective on all nodes in cart )
+     * @param stencil StencilShape::Box: all first neighbours, 
+     * StencilShape::Star: face neighbours only
+     * @return graph communicator for neighborhood collectives
+     *
+     * Only HaloEngine::Neighborhood exchanges need it, so splitters
+     * never using that engine do not pay for its creation.
+     */
+    MPI_Comm graphComm( StencilShape::type stencil );
+
   public:
+    static const int NodeAware = 2; //!< reorder value for node aware placement
+
     /** 
       * Creates a Cartesian Splitter
       * @param dims dimensions of the grid
       * @param periodicity periodicity for each direction
       * @param comm original communicator 
-      * @param reorder reorder flag
+      * @param reorder reorder flag ( 0, 1 or NodeAware )
       *
       * Must be called by every node in original communicator.
       * Creates a communicator with cartesian topology.
       *
+      * With reorder equal to NodeAware ranks are permuted so that
+      * nodes sharing memory hold compact blocks of the grid, see
+      * haloLocality().
+      *
       * If the number of nodes in original communicator is not sufficient 
       * to fill the requested grid a runtime_error exception is thrown
       *
@@ -106,7 +183,71 @@ class CartSplitter {
     CartSplitter( const std::vector<int>& dims,
                   const std::vector<int>& periodicity,
                   MPI_Comm comm, int reorder = 1 );
+
+    /** 
+      * Creates a two level Cartesian Splitter: a grid of blocks, 
+      * each block a grid of cores
+      * @param nodeDims dimensions of the grid of blocks
+      * @param coreDims dimensions of each block
+      * @param periodicity periodicity for each direction
+      * @param comm original communicator 
+      *
+      * Overall grid has nodeDims[d] * coreDims[d] nodes on direction d.
+      * Ranks of comm are taken node by node ( nodes sharing memory in 
+      * order of their lowest rank ) and cut in blocks, so that a block
+      * lives on a single node when node sizes are multiples of 
+      * prod( coreDims ).
+      *
+      * Data are split among blocks first, then among cores of each 
+      * block ( see evalDimsOffsets ); HaloEngine::Aggregated sends a
+      * single message to each neighbour block.
+      *
+      * Same rules of the other constructor apply to the size of comm.
+      */
+    CartSplitter( const std::vector<int>& nodeDims,
+                  const std::vector<int>& coreDims,
+                  const std::vector<int>& periodicity,
+                  MPI_Comm comm );
     ~CartSplitter( ); 
+
+    /**
+      * Chooses the grid minimizing overall halo volume for data 
+      * whose sizes are in dataDims
+      * @param nodes number of nodes in the grid
+      * @param dataDims sizes for each direction
+      * @param haloPre halo size before internal data, for each direction
+      * @param haloPost halo size after internal data, for each direction
+      * @return grid dimensions, whose product is nodes
+      *
+      * Among all factorizations of nodes with no more nodes than
+      * elements on each direction, minimizes the sum over blocks of 
+      * halo elements, prod( dataDims + grid * ( haloPre + haloPost ) ) 
+      * - prod( dataDims ); ties go to the most balanced grid, as in 
+      * MPI_Dims_create.
+      */
+    static std::vector<int> bestGridDims( int nodes, 
+        const std::vector<int>& dataDims,
+        const std::vector<int>& haloPre,
+        const std::vector<int>& haloPost );
+
+    /**
+      * Creates a Cartesian Splitter on all nodes of comm, with grid
+      * chosen by bestGridDims
+      * @param dataDims sizes of data to be distributed
+      * @param periodicity periodicity for each direction
+      * @param haloPre halo size before internal data, for each direction
+      * @param haloPost halo size after internal data, for each direction
+      * @param comm original communicator 
+      * @param reorder reorder flag
+      * @return pointer to CartSplitter (to be deleted by caller)
+      *
+      * Must be called by every node in original communicator.
+      */
+    static CartSplitter* createForData( const std::vector<int>& dataDims,
+        const std::vector<int>& periodicity,
+        const std::vector<int>& haloPre,
+        const std::vector<int>& haloPost,
+        MPI_Comm comm, int reorder = 1 );
   
     /**
       * Returns MPI communicator (debug use only)
@@ -176,6 +317,15 @@ class CartSplitter {
         return _dims;
     }
 
+    /**
+      * Returns block dimensions of a two level grid
+      * @return cores of each block on each direction ( empty for single 
+      * level grids )
+      */
+    std::vector<int> getCoreDims() const {   
+      return _coreDims;
+    }
+
    /**
       * Returns the rank of the current node.  If grid is 
       * obtained with reorder=1, rank in the new communicator may be
@@ -241,6 +391,26 @@ class CartSplitter {
                        std::vector< std::vector<int> >& localDims,
                        std::vector< std::vector<int> >& localOffset ) const;
 
+    /**
+      * Evaluates local dimensions and offsets balancing a cost profile
+      * @param dataDims sizes for each direction (contiguous data on last direction)
+      * @param weights cost of each slab, for each direction ( dataDims[dd] 
+      * values, or empty / all zero for uniform cost )
+      * @param localDims local data dimensions for each node 
+      * @param localOffset offset for each dimension in each node
+      *
+      * Split points are chosen independently on each direction, so that 
+      * blocks keep a tensor product structure; each block has at least 
+      * a slab when dataDims allow it.
+      *
+      * On two level grids each direction is split among blocks, then 
+      * each block part among its cores.
+      */
+    void evalDimsOffsets ( const std::vector<int>& dataDims, 
+                       const std::vector< std::vector<double> >& weights,
+                       std::vector< std::vector<int> >& localDims,
+                       std::vector< std::vector<int> >& localOffset ) const;
+
     /**
       * Synchronization barrier on nodes in cart
       * must be called by all nodes in cart
@@ -257,15 +427,57 @@ class CartSplitter {
      * @param haloPost number of elements in halo, 
      * after internal data 
      * @param haloType ( 1=no halos, 2=full, 3=tight)
+     * @param haloMode ( HaloMode::Direct or HaloMode::Sweep )
+     * @param stencil ( StencilShape::Box or StencilShape::Star )
+     * @param components number of T values in each element
+     * @param rowAlign local last dimension is padded to a multiple
+     * of rowAlign elements, avoiding 4 KiB row strides ( 1: no padding )
      * create a distributed description for data
       *
+      * In HaloMode::Direct a message is exchanged with each of the 
+      * 3^d-1 first neighbours; HaloMode::Sweep exchanges faces one 
+      * dimension at a time, halos of previous dimensions included, 
+      * so that edges and corners are filled with 2*d messages.
+      *
+      * With StencilShape::Star only faces are exchanged: edge and
+      * corner halos are neither filled nor given a datatype.
+      *
+      * Components of an element are interleaved ( array of structs ):
+      * scatter, gather and halo exchange move all of them together.
+      *
+      * Row padding is never exchanged: when rowAlign elements span a 
+      * multiple of 64 bytes, buffers from 
+      * DistributedDescription::createLocalBuffer() have all rows aligned.
       */ 
     template <typename T>
     DistributedDescription<T>* 
     createDistributedDescription( const std::vector<int>& dims,
         const std::vector<int>& haloPre,
         const std::vector<int>& haloPost,
-        HaloType::type haloType = HaloType::Full );
+        HaloType::type haloType = HaloType::Full,
+        HaloMode::type haloMode = HaloMode::Direct,
+        StencilShape::type stencil = StencilShape::Box,
+        int components = 1, int rowAlign = 1 );
+
+    /**
+     * Creates an instance of DistributedDescription class, with blocks
+     * balancing a cost profile ( see evalDimsOffsets )
+     * @param dims dimension of nd-data to be distributed
+     * @param weights cost of each slab, for each direction
+     * @param haloPre number of elements in halo, before internal data 
+     * @param haloPost number of elements in halo, after internal data 
+     * other parameters as above
+     */ 
+    template <typename T>
+    DistributedDescription<T>* 
+    createDistributedDescription( const std::vector<int>& dims,
+        const std::vector< std::vector<double> >& weights,
+        const std::vector<int>& haloPre,
+        const std::vector<int>& haloPost,
+        HaloType::type haloType = HaloType::Full,
+        HaloMode::type haloMode = HaloMode::Direct,
+        StencilShape::type stencil = StencilShape::Box,
+        int components = 1, int rowAlign = 1 );
 
     /**
      * Creates an instance of DistributedDescription class 
@@ -275,13 +487,20 @@ class CartSplitter {
      * @param haloPost number of elements in halo, 
      * after internal data (for all directions)
      * @param haloType ( HaloType::Full or HaloType::Tight )
+     * @param haloMode ( HaloMode::Direct or HaloMode::Sweep )
+     * @param stencil ( StencilShape::Box or StencilShape::Star )
+     * @param components number of T values in each element
+     * @param rowAlign see above
      */ 
     template <typename T>
     DistributedDescription<T>* 
     createDistributedDescription( const std::vector<int>& dims,
         int haloPre = 0,
         int haloPost = 0,
-        HaloType::type haloType = HaloType::Full );
+        HaloType::type haloType = HaloType::Full,
+        HaloMode::type haloMode = HaloMode::Direct,
+        StencilShape::type stencil = StencilShape::Box,
+        int components = 1, int rowAlign = 1 );
 
     /**
      * Scatters data contained in data
@@ -290,6 +509,9 @@ class CartSplitter {
      * correctly: see DistributedDescription.getLocalSize() )
      * @param root source node
      * @param dd pointer to DistributedDescription
+     * @param mode CollectiveMode::Flat is a single MPI_Alltoallw on the
+     * cart communicator; CollectiveMode::Hierarchical sends a single 
+     * message to each shared memory node, distributed by its leader
      *
      * This methods scatters only the internal portion, see
      * haloUpdate.
@@ -297,8 +519,59 @@ class CartSplitter {
     template <typename T>
     void scatter( const std::vector<T>& data,
                   std::vector<T>& localData, int root,
-                  const DistributedDescription<T> * dd );
+                  const DistributedDescription<T> * dd,
+                  CollectiveMode::type mode = CollectiveMode::Flat );
+
+    /**
+     * Scatters data on externally owned buffers, see scatter
+     * @param data source data (must be valid at root)
+     * @param dataSize number of values in data ( checked at root only )
+     * @param localData local buffer to be filled
+     * @param localSize number of values in localData
+     * @param root source node
+     * @param dd pointer to DistributedDescription
+     * @param mode see scatter
+     */ 
+    template <typename T>
+    void scatter( const T * data, size_t dataSize,
+                  T * localData, size_t localSize, int root,
+                  const DistributedDescription<T> * dd,
+                  CollectiveMode::type mode = CollectiveMode::Flat );
     
+    /**
+     * Scatters data generated at root one slab at a time
+     * @param producer callable as producer( first, count, slab ) at root:
+     * fills slab with count rows ( outermost dimension ) of overall data, 
+     * starting at row first
+     * @param localData local data to be filled (must be allocated
+     * correctly: see DistributedDescription.getLocalSize() )
+     * @param root source node
+     * @param dd pointer to DistributedDescription
+     * @param slabRows number of rows in each slab
+     *
+     * Root holds two slabs, so that producing a slab overlaps
+     * sending the previous one; overall data is never allocated.
+     * As scatter, fills only the internal portion.
+     */ 
+    template <typename T, typename Producer>
+    void scatterStream( Producer producer,
+                  std::vector<T>& localData, int root,
+                  const DistributedDescription<T> * dd, int slabRows );
+
+    /**
+     * Streamed scatter to an externally owned buffer, see scatterStream
+     * @param producer callable filling a slab
+     * @param localData local buffer to be filled
+     * @param localSize number of values in localData
+     * @param root source node
+     * @param dd pointer to DistributedDescription
+     * @param slabRows number of rows in each slab
+     */ 
+    template <typename T, typename Producer>
+    void scatterStream( Producer producer,
+                  T * localData, size_t localSize, int root,
+                  const DistributedDescription<T> * dd, int slabRows );
+
     /**
      * Gathers internal part of localData
      * @param localData source data (must be valid for all nodes)
@@ -306,146 +579,960 @@ class CartSplitter {
      * correctly: see DistributedDescription.getTotalSize() )
      * @param root destination node
      * @param dd pointer to DistributedDescription
+     * @param mode CollectiveMode::Hierarchical collects internal 
+     * portions on node leaders, each sending a single message to root
      */ 
     template <typename T>
       void gather( const std::vector<T>& localData, 
           std::vector<T>& newData, 
-          int root, const DistributedDescription<T> * dd );
-    
+          int root, const DistributedDescription<T> * dd,
+          CollectiveMode::type mode = CollectiveMode::Flat );
+
     /**
-     * Starts neighbours data exchange for halo filling 
+     * Gathers on externally owned buffers, see gather
      * @param localData source data (must be valid for all nodes)
+     * @param localSize number of values in localData
+     * @param newData data to be filled (must be valid at root)
+     * @param newSize number of values in newData ( checked at root only )
+     * @param root destination node
      * @param dd pointer to DistributedDescription
+     * @param mode see gather
      */ 
     template <typename T>
-      void haloUpdate( std::vector<T>& localData, 
-          const DistributedDescription<T> * dd );
+      void gather( const T * localData, size_t localSize,
+          T * newData, size_t newSize,
+          int root, const DistributedDescription<T> * dd,
+          CollectiveMode::type mode = CollectiveMode::Flat );
 
-};
+    /**
+     * Moves internal portions between two decompositions of the same data
+     * @param srcData local data described by srcDD (must be valid for all nodes)
+     * @param srcDD pointer to source DistributedDescription
+     * @param dstData local data to be filled, described by dstDD
+     * @param dstDD pointer to destination DistributedDescription
+     *
+     * Each node exchanges only the intersections of its blocks with the
+     * blocks of other nodes, in a single MPI_Alltoallw: no data goes 
+     * through a root. Descriptions must share overall dimensions and 
+     * components; halos of dstData are not filled.
+     */ 
+    template <typename T>
+      void redistribute( const std::vector<T>& srcData, 
+          const DistributedDescription<T> * srcDD,
+          std::vector<T>& dstData, const DistributedDescription<T> * dstDD );
 
-template <typename T>
-DistributedDescription<T>* 
-    CartSplitter::createDistributedDescription( const std::vector<int>& dims,
-        const std::vector<int>& haloPre,
-        const std::vector<int>& haloPost,
-        HaloType::type haloType  ){
+    /**
+     * Redistribution on externally owned buffers, see redistribute
+     * @param srcData local data described by srcDD
+     * @param srcSize number of values in srcData
+     * @param srcDD pointer to source DistributedDescription
+     * @param dstData local data to be filled ( distinct from srcData )
+     * @param dstSize number of values in dstData
+     * @param dstDD pointer to destination DistributedDescription
+     */ 
+    template <typename T>
+      void redistribute( const T * srcData, size_t srcSize,
+          const DistributedDescription<T> * srcDD,
+          T * dstData, size_t dstSize, const DistributedDescription<T> * dstDD );
 
-      DistributedDescription<T> * dd = new DistributedDescription<T>( dims );
+    /**
+     * Reads internal part of localData from a file holding overall data
+     * @param filename file name ( raw data, C order, native representation )
+     * @param localData local data to be filled (must be allocated
+     * correctly: see DistributedDescription.getLocalSize() )
+     * @param dd pointer to DistributedDescription
+     * @param displacement offset of first value in file ( bytes )
+     *
+     * Collective MPI-IO read: each node reads its own internal
+     * portion, no node holds overall data. Halos are not filled.
+     */ 
+    template <typename T>
+      void readDistributed( const std::string& filename,
+          std::vector<T>& localData, const DistributedDescription<T> * dd,
+          MPI_Offset displacement = 0 );
 
-      // evaluates internal sizes and offsets for each node
-      evalDimsOffsets( dims, dd->_subSizes, dd->_starts );
+    /**
+     * Reads to an externally owned buffer, see readDistributed
+     * @param filename file name
+     * @param localData local buffer to be filled
+     * @param localSize number of values in localData
+     * @param dd pointer to DistributedDescription
+     * @param displacement offset of first value in file ( bytes )
+     */ 
+    template <typename T>
+      void readDistributed( const std::string& filename,
+          T * localData, size_t localSize, const DistributedDescription<T> * dd,
+          MPI_Offset displacement = 0 );
 
-      // creates MPI_Datatype for each internal portion ( root side )
-      dd->fillInternalTypes();
+    /**
+     * Writes internal part of localData to a file holding overall data
+     * @param filename file name ( created if missing )
+     * @param localData source data (must be valid for all nodes)
+     * @param dd pointer to DistributedDescription
+     * @param displacement offset of first value in file ( bytes )
+     *
+     * Collective MPI-IO write, see readDistributed.
+     */ 
+    template <typename T>
+      void writeDistributed( const std::string& filename,
+          const std::vector<T>& localData, const DistributedDescription<T> * dd,
+          MPI_Offset displacement = 0 );
 
-      // evaluates local halo dimensions 
-      dd->fillHaloSizes( haloPre, haloPost, haloType, _coordinates, _dims );
+    /**
+     * Writes from an externally owned buffer, see writeDistributed
+     * @param filename file name ( created if missing )
+     * @param localData local buffer
+     * @param localSize number of values in localData
+     * @param dd pointer to DistributedDescription
+     * @param displacement offset of first value in file ( bytes )
+     */ 
+    template <typename T>
+      void writeDistributed( const std::string& filename,
+          const T * localData, size_t localSize, 
+          const DistributedDescription<T> * dd, MPI_Offset displacement = 0 );
+    
+    /**
+     * Starts neighbours data exchange for halo filling 
+     * @param localData source data (must be valid for all nodes)
+     * @param dd pointer to DistributedDescription
+     */ 
+    template <typename T>
+      void haloUpdate( std::vector<T>& localData, 
+          const DistributedDescription<T> * dd );
 
-      // creates MPI_Datatype for internal portion ( local side )
-      dd->fillLocalSizes( _cartRank );
+    /**
+     * Halo exchange in place on an externally owned buffer, see haloUpdate
+     * @param localData local buffer (must be valid for all nodes)
+     * @param localSize number of values in localData
+     * @param dd pointer to DistributedDescription
+     */ 
+    template <typename T>
+      void haloUpdate( T * localData, size_t localSize,
+          const DistributedDescription<T> * dd );
 
-      // creates local type for scatter/gather
-      dd->fillLocalType();
+    /**
+     * Posts all neighbours data exchanges for halo filling,
+     * without waiting for their completion
+     * @param localData source data (must be valid for all nodes)
+     * @param dd pointer to DistributedDescription
+     * @return handle to be completed with haloUpdateEnd
+     *
+     * Internal portion of localData can be read while exchange 
+     * is in progress; neither halos nor localData can be modified
+     * until haloUpdateEnd returns.
+     *
+     * In HaloMode::Sweep all dimensions but last one are exchanged
+     * before returning; with HaloEngine::Aggregated, regions crossing 
+     * blocks are.
+     */ 
+    template <typename T>
+      HaloRequest haloUpdateBegin( std::vector<T>& localData, 
+          const DistributedDescription<T> * dd );
 
-      // creates halo types
-      dd->fillHaloTypes( _directions );
+    /**
+     * Posts halo exchange on an externally owned buffer, see haloUpdateBegin
+     * @param localData local buffer (must be valid for all nodes)
+     * @param localSize number of values in localData
+     * @param dd pointer to DistributedDescription
+     * @return handle to be completed with haloUpdateEnd
+     */ 
+    template <typename T>
+      HaloRequest haloUpdateBegin( T * localData, size_t localSize,
+          const DistributedDescription<T> * dd );
 
+    /**
+     * Waits for completion of a halo exchange started by haloUpdateBegin
+     * @param request handle returned by haloUpdateBegin
+     */ 
+    void haloUpdateEnd( HaloRequest& request );
 
-      return dd;
-}
+    /**
+     * Halo exchange overlapped with computation on internal portion
+     * @param localData local buffer (must be valid for all nodes)
+     * @param dd pointer to DistributedDescription
+     * @param kernel callable as kernel( const LocalRegion& ): computes 
+     * on a region of localData
+     *
+     * Kernel runs on DistributedDescription::getInteriorRegion() while 
+     * the exchange is in progress, then on each of the 
+     * DistributedDescription::getBoundaryRegions() once halos are 
+     * filled. Kernel must not write localData ( e.g. it writes 
+     * a second buffer ).
+     */ 
+    template <typename T, typename Kernel>
+      void haloUpdateOverlap( std::vector<T>& localData, 
+          const DistributedDescription<T> * dd, Kernel kernel );
 
-template <typename T>
-DistributedDescription<T>* 
-    CartSplitter::createDistributedDescription( const std::vector<int>& dims,
-        int haloPre,
-        int haloPost,
-        HaloType::type haloType  ){
-   
-      std::vector<int> v_haloPre( dims.size(), haloPre );
-      std::vector<int> v_haloPost( dims.size(), haloPost );
+    /**
+     * Overlapped halo exchange on an externally owned buffer, 
+     * see haloUpdateOverlap
+     * @param localData local buffer (must be valid for all nodes)
+     * @param localSize number of values in localData
+     * @param dd pointer to DistributedDescription
+     * @param kernel see haloUpdateOverlap
+     */ 
+    template <typename T, typename Kernel>
+      void haloUpdateOverlap( T * localData, size_t localSize,
+          const DistributedDescription<T> * dd, Kernel kernel );
 
-      return createDistributedDescription<T> ( dims, v_haloPre, 
-          v_haloPost, haloType ); 
-}
+    /**
+     * Sets the number of threads used by HaloEngine::Threaded
+     * and parallelForInterior
+     * @param threads number of threads, calling one included
+     *
+     * Each thread owns a subset of directions, balanced by size: it 
+     * packs, exchanges and unpacks them. If MPI was initialized with
+     * MPI_THREAD_MULTIPLE threads post their own messages, otherwise 
+     * only the calling thread does ( funneled ).
+     *
+     * Threads are used by haloUpdate only: haloUpdateBegin and plans 
+     * behave as HaloEngine::Packed.
+     */
+    void setHaloThreads( int threads );
 
-template <typename T>
-void CartSplitter::scatter( const std::vector<T>& data,
-    std::vector<T>& localData, int root,
-    const DistributedDescription<T> * dd )
-{
+    /**
+     * Returns the number of threads used by HaloEngine::Threaded
+     * @return number of threads, calling one included
+     */
+    int getHaloThreads() const { return _pool ? _pool->size() : 1; }
 
-  // data distribution ( needs types, data, data type, localData )
-  if ( root == _cartRank ){
+    /**
+     * Runs kernel on internal cells, tile by tile, on the threads 
+     * set by setHaloThreads
+     * @param dd pointer to DistributedDescription
+     * @param kernel callable as kernel( const LocalRegion& ), as in
+     * haloUpdateOverlap: called once for each tile, from any thread
+     * @param boundaryFirst if true, all tiles reading halos complete 
+     * before other tiles start
+     * @param tileBytes target tile size ( see DistributedDescription::getTiles )
+     *
+     * Tiles are scheduled with work stealing: concurrent kernel calls
+     * always get disjoint tiles.
+     */
+    template <typename T, typename Kernel>
+      void parallelForInterior( const DistributedDescription<T> * dd, 
+          Kernel kernel, bool boundaryFirst = false, 
+          size_t tileBytes = 32768 );
 
-    std::vector< MPI_Request > requests( _cartSize );
-    for ( int node = 0; node < _cartSize; ++node ) 
-      mpiSafeCall( MPI_Isend( &data[0], 1, dd->_types[node], 
-            node, 333, _comm, &requests[node] ) );
+    /**
+     * Creates a persistent halo exchange plan on localData
+     * @param localData local buffer (must not be reallocated while
+     * plan is alive)
+     * @param dd pointer to DistributedDescription
+     * @return pointer to HaloPlan (to be deleted by caller)
+     *
+     * Must be called by all nodes in cart. HaloEngine::Aggregated
+     * is not supported.
+     */ 
+    template <typename T>
+      HaloPlan* createHaloPlan( std::vector<T>& localData, 
+          const DistributedDescription<T> * dd );
 
-    MPI_Status status; 
-    for ( int node = 0; node < _cartSize; ++node ){
-      if ( node != root )
-        mpiSafeCall( MPI_Wait( &requests[node], &status ) );    
-    }
+    /**
+     * Creates a persistent halo exchange plan on an externally owned 
+     * buffer, see createHaloPlan
+     * @param localData local buffer (must stay valid while plan is alive)
+     * @param localSize number of values in localData
+     * @param dd pointer to DistributedDescription
+     * @return pointer to HaloPlan (to be deleted by caller)
+     */ 
+    template <typename T>
+      HaloPlan* createHaloPlan( T * localData, size_t localSize,
+          const DistributedDescription<T> * dd );
 
-    // my matching receive
-    mpiSafeCall( MPI_Recv( &localData[0], 1, dd->_localDatatype, 
-          root, 333, _comm, &status ) );
+    /**
+     * Neighbours data exchange for halo filling of several fields
+     * @param fields local buffers sharing the same DistributedDescription
+     * @param dd pointer to DistributedDescription
+     *
+     * A single message per neighbour carries the halos of all fields.
+     * Convenience wrapper on createHaloPlan( fields, dd ): struct 
+     * datatypes and persistent requests are built and freed on each
+     * call, use a HaloPlan for repeated exchanges on the same fields.
+     */ 
+    template <typename T>
+      void haloUpdate( const std::vector< std::vector<T>* >& fields, 
+          const DistributedDescription<T> * dd );
 
-    // collect the status of root->root 
-    mpiSafeCall( MPI_Wait( &requests[root], &status ) );    
+    /**
+     * Creates a persistent halo exchange plan on several fields
+     * @param fields local buffers sharing the same DistributedDescription
+     * (must not be reallocated while plan is alive; empty: plan 
+     * exchanging nothing)
+     * @param dd pointer to DistributedDescription
+     * @return pointer to HaloPlan (to be deleted by caller)
+     *
+     * Halos of all fields are described by a struct datatype on 
+     * absolute addresses, so that a single message per neighbour 
+     * is exchanged. Datatypes are used whatever the HaloEngine.
+     * Must be called by all nodes in cart.
+     */ 
+    template <typename T>
+      HaloPlan* createHaloPlan( const std::vector< std::vector<T>* >& fields, 
+          const DistributedDescription<T> * dd );
 
-  }
-  else{    
-    // data receive
-    MPI_Status status;
-    mpiSafeCall( MPI_Recv( &localData[0], 1, dd->_localDatatype, 
-          root, 333, _comm, &status ) );
-  }
+    /**
+     * Creates a local buffer in node shared memory
+     * @param dd pointer to DistributedDescription (in HaloMode::Direct)
+     * @return pointer to SharedHalo (to be deleted by caller)
+     *
+     * Halos coming from neighbours on the same node are loaded 
+     * directly from their buffers, the others are exchanged as 
+     * in haloUpdate. Must be called by all nodes in cart.
+     */ 
+    template <typename T>
+      SharedHalo<T>* createSharedHalo( const DistributedDescription<T> * dd );
 
-}
+    /**
+     * Creates a one sided halo exchange on localData
+     * @param localData local buffer (must not be reallocated while
+     * exchange object is alive)
+     * @param dd pointer to DistributedDescription (in HaloMode::Direct)
+     * @return pointer to RmaHalo (to be deleted by caller)
+     *
+     * Must be called by all nodes in cart.
+     */ 
+    template <typename T>
+      RmaHalo* createRmaHalo( std::vector<T>& localData,
+          const DistributedDescription<T> * dd );
 
+    /**
+     * Creates a one sided halo exchange on an externally owned buffer,
+     * see createRmaHalo
+     * @param localData local buffer (must stay valid while exchange 
+     * object is alive)
+     * @param localSize number of values in localData
+     * @param dd pointer to DistributedDescription (in HaloMode::Direct)
+     * @return pointer to RmaHalo (to be deleted by caller)
+     */ 
+    template <typename T>
+      RmaHalo* createRmaHalo( T * localData, size_t localSize,
+          const DistributedDescription<T> * dd );
 
-template <typename T>
-void CartSplitter::gather( const std::vector<T>& localData, 
-    std::vector<T>& newData, 
-    int root, const DistributedDescription<T> * dd ){
+    /**
+     * Evaluates how many halo bytes stay on shared memory nodes
+     * @param dd pointer to DistributedDescription
+     * @return bytes exchanged by a halo update, summed on all nodes in cart
+     *
+     * Must be called by all nodes in cart.
+     */ 
+    template <typename T>
+      HaloLocality haloLocality( const DistributedDescription<T> * dd ) const;
 
-  // data collection ( needs types, newdata, data type, localData )
-  if ( root == _cartRank ){
+  private:
+    /**
+     * Throws if a buffer is smaller than required
+     * @param size number of values in buffer
+     * @param required number of values needed
+     * @param caller name of calling method ( for error message )
+     */
+    void checkBufferSize( size_t size, size_t required, 
+        const char * caller ) const;
+
+    /**
+     * Adds persistent exchange of several fields along a direction to plan
+     * @param addresses absolute address of each field
+     * @param sendType send datatype for a single field (0 if unused)
+     * @param recvType receive datatype for a single field (0 if unused)
+     * @param dest destination node
+     * @param src source node
+     * @param plan plan to be filled
+     */
+    void initFieldsExchange( const std::vector< MPI_Aint >& addresses,
+        MPI_Datatype sendType, MPI_Datatype recvType, 
+        int dest, int src, HaloPlan * plan );
+
+    /**
+     * Posts face exchanges of a dimension sweep phase
+     * @param localData local buffer
+     * @param dd pointer to DistributedDescription (in HaloMode::Sweep)
+     * @param dim dimension to be exchanged
+     * @param requests array of at least 4 requests
+     * @param persistent create persistent requests instead of starting
+     * @return number of requests filled
+     */
+    template <typename T>
+      int postSweepPhase( T * localData, 
+          const DistributedDescription<T> * dd, int dim,
+          MPI_Request * requests, bool persistent );
+
+    /**
+     * Posts exchanges of staging buffers ( HaloEngine::Packed )
+     * @param localData local buffer
+     * @param dd pointer to DistributedDescription
+     * @param requests vector to be filled with requests
+     * @param persistent create persistent requests instead of starting
+     *
+     * When requests are started, send regions are packed before 
+     * sends are posted.
+     */
+    template <typename T>
+      void postPacked( T * localData, 
+          const DistributedDescription<T> * dd, 
+          std::vector< MPI_Request >& requests, bool persistent );
 
-    std::vector< MPI_Request > requests( _cartSize );
-    for ( int node = 0; node < _cartSize; ++node ) 
-      mpiSafeCall( MPI_Irecv( &newData[0], 1, dd->_types[node], 
-            node, 666, _comm, &requests[node] ) );
+    /**
+     * Builds datatypes moving regions that cross blocks of a two level
+     * grid through block leaders ( HaloEngine::Aggregated )
+     * @param dd pointer to DistributedDescription, with packed regions
+     *
+     * Must be called by all nodes in cart.
+     */
+    template <typename T>
+      void fillBlockExchange( DistributedDescription<T> * dd );
+
+    /**
+     * Moves regions crossing blocks from _sendBuffer to neighbours
+     * _receiveBuffer: members to block leader, one message between
+     * leaders of neighbour blocks, block leader to members
+     * @param dd pointer to DistributedDescription ( packed halos )
+     *
+     * Must be called by all nodes in cart; blocking.
+     */
+    template <typename T>
+      void exchangeBlocks( const DistributedDescription<T> * dd );
 
-    // my matching send
-    mpiSafeCall( MPI_Send( &localData[0], 1, dd->_localDatatype, 
-          root, 666, _comm ) );
+    /**
+     * Halo exchange with directions spread over _pool ( HaloEngine::Threaded )
+     * @param localData local buffer
+     * @param dd pointer to DistributedDescription ( packed regions )
+     */
+    template <typename T>
+      void threadedExchange( T * localData, 
+          const DistributedDescription<T> * dd );
 
-    MPI_Status status; 
-    for ( int node = 0; node < _cartSize; ++node ){
-      if ( node != root )
-        mpiSafeCall( MPI_Wait( &requests[node], &status ) );    
+    /**
+     * Creates the datatype of all internal portions on a shared memory
+     * node, in rank order ( used by root in hierarchical scatter/gather )
+     * @param dd pointer to DistributedDescription
+     * @param leader node leader
+     * @return committed datatype ( to be freed by caller )
+     */
+    template <typename T>
+      MPI_Datatype createNodeType( const DistributedDescription<T> * dd,
+          int leader ) const;
+
+    /**
+     * Returns the node shared buffer holding internal portions of all 
+     * nodes sharing memory with current node, in rank order
+     * @param dd pointer to DistributedDescription
+     * @param count number of elements in buffer
+     * @param offset offset of current node portion ( in values )
+     * @return first value of node buffer
+     *
+     * Collective on the node communicator, see reserveNodeWindow.
+     */
+    template <typename T>
+      T * nodeBuffer( const DistributedDescription<T> * dd,
+          int * count, size_t * offset );
+
+    /**
+     * Grows _nodeWin to at least bytes, allocated by node leader
+     * @param bytes size needed on current shared memory node
+     *
+     * Collective on the node communicator: bytes is the same for all
+     * its members, so they agree on reallocation. The window is kept
+     * locked for load/store access and freed by the destructor.
+     */
+    void reserveNodeWindow( MPI_Aint bytes );
+
+    /**
+     * Hierarchical version of scatter, see CollectiveMode
+     */
+    template <typename T>
+      void scatterHierarchical( const T * data,
+          T * localData, int root,
+          const DistributedDescription<T> * dd );
+
+    /**
+     * Hierarchical version of gather, see CollectiveMode
+     */
+    template <typename T>
+      void gatherHierarchical( const T * localData, 
+          T * newData, int root, 
+          const DistributedDescription<T> * dd );
+
+};
+
+template <typename T>
+DistributedDescription<T>* 
+    CartSplitter::createDistributedDescription( const std::vector<int>& dims,
+        const std::vector<int>& haloPre,
+        const std::vector<int>& haloPost,
+        HaloType::type haloType,
+        HaloMode::type haloMode,
+        StencilShape::type stencil,
+        int components, int rowAlign ){
+
+      return createDistributedDescription<T> ( dims, 
+          std::vector< std::vector<double> >( dims.size() ), haloPre, 
+          haloPost, haloType, haloMode, stencil, components, rowAlign ); 
+}
+
+template <typename T>
+DistributedDescription<T>* 
+    CartSplitter::createDistributedDescription( const std::vector<int>& dims,
+        const std::vector< std::vector<double> >& weights,
+        const std::vector<int>& haloPre,
+        const std::vector<int>& haloPost,
+        HaloType::type haloType,
+        HaloMode::type haloMode,
+        StencilShape::type stencil,
+        int components, int rowAlign ){
+
+      // evaluates internal sizes and offsets for each node
+      std::vector< std::vector<int> > subSizes, starts;
+      evalDimsOffsets( dims, weights, subSizes, starts );
+
+      DistributedDescription<T> * dd = new DistributedDescription<T>( dims, 
+          components );
+      dd->_haloMode = haloMode;
+      dd->_subSizes.swap( subSizes );
+      dd->_starts.swap( starts );
+
+      // creates MPI_Datatype for each internal portion ( root side )
+      dd->fillInternalTypes();
+
+      // evaluates local halo dimensions 
+      dd->fillHaloSizes( haloPre, haloPost, haloType, _coordinates, _dims );
+
+      // creates MPI_Datatype for internal portion ( local side )
+      dd->fillLocalSizes( _cartRank, rowAlign );
+
+      // creates local type for scatter/gather
+      dd->fillLocalType();
+
+      // interior and boundary regions for overlapped exchange
+      dd->fillOverlapRegions();
+
+      // directions needed by stencil
+      dd->fillActiveDirections( _directions, stencil );
+
+      if ( haloMode == HaloMode::Sweep ){
+        // creates face types, extended for box stencils
+        dd->fillSweepTypes( stencil == StencilShape::Box );
+      }
+      else {
+        // creates halo types
+        dd->fillHaloTypes( _directions );
+
+        // arguments for neighborhood collectives on graphComm( stencil )
+        dd->fillNeighborhoodArgs( _srcNeighbours, _destNeighbours );
+
+        // regions for explicit packing
+        dd->fillPackedRegions( _directions, _srcNeighbours, _destNeighbours );
+
+        // regions crossing blocks, aggregated by block leaders
+        if ( !_coreDims.empty() )
+          fillBlockExchange( dd );
+      }
+
+
+      return dd;
+}
+
+template <typename T>
+DistributedDescription<T>* 
+    CartSplitter::createDistributedDescription( const std::vector<int>& dims,
+        int haloPre,
+        int haloPost,
+        HaloType::type haloType,
+        HaloMode::type haloMode,
+        StencilShape::type stencil,
+        int components, int rowAlign ){
+   
+      std::vector<int> v_haloPre( dims.size(), haloPre );
+      std::vector<int> v_haloPost( dims.size(), haloPost );
+
+      return createDistributedDescription<T> ( dims, v_haloPre, 
+          v_haloPost, haloType, haloMode, stencil, components, rowAlign ); 
+}
+
+template <typename T>
+void CartSplitter::scatter( const std::vector<T>& data,
+    std::vector<T>& localData, int root,
+    const DistributedDescription<T> * dd, CollectiveMode::type mode )
+{
+  scatter( data.data(), data.size(), localData.data(), localData.size(),
+      root, dd, mode );
+}
+
+template <typename T>
+void CartSplitter::scatter( const T * data, size_t dataSize,
+    T * localData, size_t localSize, int root,
+    const DistributedDescription<T> * dd, CollectiveMode::type mode )
+{
+
+  checkBufferSize( localSize, dd->getLocalSize(), "scatter" );
+  if ( root == _cartRank )
+    checkBufferSize( dataSize, dd->getTotalSize(), "scatter" );
+
+  if ( mode == CollectiveMode::Hierarchical ){
+    scatterHierarchical( data, localData, root, dd );
+    return;
+  }
+
+  // data distribution as a collective: root sends a subarray
+  // to each node, each node receives one local type from root
+  dd->fillCollectiveArgs( root, _cartRank );
+  mpiSafeCall( MPI_Alltoallw( data, 
+        &dd->_rootCounts[0], &dd->_collDispls[0], &dd->_rootTypes[0],
+        localData, 
+        &dd->_memberCounts[0], &dd->_collDispls[0], &dd->_memberTypes[0], 
+        _comm ) );
+
+}
+
+
+template <typename T>
+void CartSplitter::gather( const std::vector<T>& localData, 
+    std::vector<T>& newData, 
+    int root, const DistributedDescription<T> * dd, 
+    CollectiveMode::type mode ){
+  gather( localData.data(), localData.size(), newData.data(), newData.size(),
+      root, dd, mode );
+}
+
+template <typename T>
+void CartSplitter::gather( const T * localData, size_t localSize,
+    T * newData, size_t newSize,
+    int root, const DistributedDescription<T> * dd, 
+    CollectiveMode::type mode ){
+
+  checkBufferSize( localSize, dd->getLocalSize(), "gather" );
+  if ( root == _cartRank )
+    checkBufferSize( newSize, dd->getTotalSize(), "gather" );
+
+  if ( mode == CollectiveMode::Hierarchical ){
+    gatherHierarchical( localData, newData, root, dd );
+    return;
+  }
+
+  // data collection as a collective, mirror of scatter
+  dd->fillCollectiveArgs( root, _cartRank );
+  mpiSafeCall( MPI_Alltoallw( localData, 
+        &dd->_memberCounts[0], &dd->_collDispls[0], &dd->_memberTypes[0],
+        newData, 
+        &dd->_rootCounts[0], &dd->_collDispls[0], &dd->_rootTypes[0], 
+        _comm ) );
+
+}
+
+template <typename T, typename Producer>
+void CartSplitter::scatterStream( Producer producer,
+    std::vector<T>& localData, int root,
+    const DistributedDescription<T> * dd, int slabRows ){
+  scatterStream( producer, localData.data(), localData.size(), root, dd, slabRows );
+}
+
+template <typename T, typename Producer>
+void CartSplitter::scatterStream( Producer producer,
+    T * localData, size_t localSize, int root,
+    const DistributedDescription<T> * dd, int slabRows ){
+  using vector_helper::prod;
+
+  checkBufferSize( localSize, dd->getLocalSize(), "scatterStream" );
+
+  if ( slabRows < 1 )
+    throw std::runtime_error("CartSplitter::scatterStream() slabRows must be positive");
+
+  const int rows = dd->_dims[0];
+
+  // rows of internal portion of node falling into slab
+  struct Overlap {
+    static bool eval( const DistributedDescription<T> * dd, int node, 
+        int first, int count, int& lo, int& hi ){
+      lo = std::max( dd->_starts[node][0], first );
+      hi = std::min( dd->_starts[node][0] + dd->_subSizes[node][0], first + count );
+      return lo < hi;
+    }
+  };
+
+  // a receive for each slab overlapping internal portion, in slab order
+  std::vector< MPI_Request > recvRequests;
+  for( int first = 0; first < rows; first += slabRows ){
+    int lo, hi;
+    if ( !Overlap::eval( dd, _cartRank, first, slabRows, lo, hi ) )
+      continue;
+
+    std::vector<int> start( dd->_localStarts ), size( dd->_localSubSizes );
+    start[0] += lo - dd->_starts[_cartRank][0];
+    size[0] = hi - lo;
+    MPI_Datatype type;
+    dd->createRegionType( start, size, type );
+    if ( type == 0 )
+      continue;
+
+    recvRequests.push_back( MPI_REQUEST_NULL );
+    mpiSafeCall( MPI_Irecv( localData, 1, type, root, 333, _comm, 
+          &recvRequests.back() ) );
+    mpiSafeCall( MPI_Type_free( &type ) );
+  }
+
+  if ( root == _cartRank ){
+    std::vector<int> slabDims( dd->_dims );
+    const size_t slabSize = 
+      prod( slabDims.begin() + 1, slabDims.end() ) * dd->_components * slabRows;
+
+    // double buffering: a slab is refilled once its sends completed
+    std::vector<T> slabs[2] = { std::vector<T>( slabSize ), std::vector<T>( slabSize ) };
+    std::vector< MPI_Request > sendRequests[2];
+
+    for( int first = 0, bb = 0; first < rows; first += slabRows, bb = 1 - bb ){
+      std::vector<T>& slab = slabs[bb];
+      std::vector< MPI_Request >& requests = sendRequests[bb];
+      if ( !requests.empty() ){
+        mpiSafeCall( MPI_Waitall( requests.size(), &requests[0], 
+              MPI_STATUSES_IGNORE ) );
+        requests.clear();
+      }
+
+      slabDims[0] = std::min( slabRows, rows - first );
+      producer( first, slabDims[0], &slab[0] );
+
+      for( int node = 0; node < _cartSize; ++node ){
+        int lo, hi;
+        if ( !Overlap::eval( dd, node, first, slabRows, lo, hi ) )
+          continue;
+
+        std::vector<int> start( dd->_starts[node] ), size( dd->_subSizes[node] );
+        start[0] = lo - first;
+        size[0] = hi - lo;
+        MPI_Datatype type;
+        dd->createRegionType( slabDims, start, size, type );
+        if ( type == 0 )
+          continue;
+
+        requests.push_back( MPI_REQUEST_NULL );
+        mpiSafeCall( MPI_Isend( &slab[0], 1, type, node, 333, _comm, 
+              &requests.back() ) );
+        mpiSafeCall( MPI_Type_free( &type ) );
+      }
     }
 
-    // collect the status of ROOT->ROOT 
-    mpiSafeCall( MPI_Wait( &requests[root], &status ) );    
+    for( int bb = 0; bb < 2; ++bb )
+      if ( !sendRequests[bb].empty() )
+        mpiSafeCall( MPI_Waitall( sendRequests[bb].size(), &sendRequests[bb][0], 
+              MPI_STATUSES_IGNORE ) );
+  }
+
+  if ( !recvRequests.empty() )
+    mpiSafeCall( MPI_Waitall( recvRequests.size(), &recvRequests[0], 
+          MPI_STATUSES_IGNORE ) );
+}
+
+template <typename T>
+void CartSplitter::redistribute( const std::vector<T>& srcData, 
+    const DistributedDescription<T> * srcDD,
+    std::vector<T>& dstData, const DistributedDescription<T> * dstDD ){
+  redistribute( srcData.data(), srcData.size(), srcDD, 
+      dstData.data(), dstData.size(), dstDD );
+}
+
+template <typename T>
+void CartSplitter::redistribute( const T * srcData, size_t srcSize,
+    const DistributedDescription<T> * srcDD,
+    T * dstData, size_t dstSize, const DistributedDescription<T> * dstDD ){
+
+  if ( srcDD->_dims != dstDD->_dims || srcDD->_components != dstDD->_components )
+    throw std::runtime_error
+      ("CartSplitter::redistribute() descriptions of different data");
+  checkBufferSize( srcSize, srcDD->getLocalSize(), "redistribute" );
+  checkBufferSize( dstSize, dstDD->getLocalSize(), "redistribute" );
+
+  const int D = _dims.size();
+  const std::vector<int>& mySrcStarts = srcDD->_starts[_cartRank];
+  const std::vector<int>& mySrcSizes = srcDD->_subSizes[_cartRank];
+  const std::vector<int>& myDstStarts = dstDD->_starts[_cartRank];
+  const std::vector<int>& myDstSizes = dstDD->_subSizes[_cartRank];
+
+  // intersection of two blocks in local coordinates of the first one
+  struct Intersection {
+    static void eval( const std::vector<int>& starts, const std::vector<int>& sizes,
+        const std::vector<int>& otherStarts, const std::vector<int>& otherSizes,
+        const std::vector<int>& localStarts,
+        std::vector<int>& start, std::vector<int>& size ){
+      start.resize( starts.size() );
+      size.resize( starts.size() );
+      for( unsigned int dd = 0; dd < starts.size(); ++dd ){
+        int lo = std::max( starts[dd], otherStarts[dd] );
+        int hi = std::min( starts[dd] + sizes[dd], otherStarts[dd] + otherSizes[dd] );
+        start[dd] = localStarts[dd] + lo - starts[dd];
+        size[dd] = std::max( hi - lo, 0 );
+        if ( size[dd] == 0 )
+          start[dd] = 0;
+      }
+    }
+  };
 
+  std::vector<int> sendCounts( _cartSize, 0 ), recvCounts( _cartSize, 0 );
+  std::vector<int> displs( _cartSize, 0 );
+  std::vector< MPI_Datatype > sendTypes( _cartSize, MPI_BYTE ), 
+    recvTypes( _cartSize, MPI_BYTE );
+
+  std::vector<int> start( D ), size( D );
+  for( int node = 0; node < _cartSize; ++node ){
+    MPI_Datatype type;
+
+    // my source block inside destination block of node
+    Intersection::eval( mySrcStarts, mySrcSizes, dstDD->_starts[node], 
+        dstDD->_subSizes[node], srcDD->_localStarts, start, size );
+    srcDD->createRegionType( start, size, type );
+    if ( type != 0 ){
+      sendCounts[node] = 1;
+      sendTypes[node] = type;
+    }
+
+    // source block of node inside my destination block
+    Intersection::eval( myDstStarts, myDstSizes, srcDD->_starts[node], 
+        srcDD->_subSizes[node], dstDD->_localStarts, start, size );
+    dstDD->createRegionType( start, size, type );
+    if ( type != 0 ){
+      recvCounts[node] = 1;
+      recvTypes[node] = type;
+    }
+  }
+
+  mpiSafeCall( MPI_Alltoallw( srcData, &sendCounts[0], &displs[0], &sendTypes[0],
+        dstData, &recvCounts[0], &displs[0], &recvTypes[0], _comm ) );
+
+  for( int node = 0; node < _cartSize; ++node ){
+    if ( sendCounts[node] ) 
+      mpiSafeCall( MPI_Type_free( &sendTypes[node] ) );
+    if ( recvCounts[node] ) 
+      mpiSafeCall( MPI_Type_free( &recvTypes[node] ) );
   }
-  else{    
-    // data send
-    mpiSafeCall( MPI_Send( &localData[0], 1, dd->_localDatatype, 
-          root, 666, _comm ) );
+}
+
+template <typename T>
+void CartSplitter::readDistributed( const std::string& filename,
+    std::vector<T>& localData, const DistributedDescription<T> * dd,
+    MPI_Offset displacement ){
+  readDistributed( filename, localData.data(), localData.size(), dd, displacement );
+}
+
+template <typename T>
+void CartSplitter::readDistributed( const std::string& filename,
+    T * localData, size_t localSize, const DistributedDescription<T> * dd,
+    MPI_Offset displacement ){
+
+  checkBufferSize( localSize, dd->getLocalSize(), "readDistributed" );
+
+  // file view: internal portion of current node in overall data
+  MPI_File fh;
+  mpiSafeCall( MPI_File_open( _comm, filename.c_str(), MPI_MODE_RDONLY, 
+        MPI_INFO_NULL, &fh ) );
+  try {
+    mpiSafeCall( MPI_File_set_view( fh, displacement, dd->_elementType, 
+          dd->_types[_cartRank], "native", MPI_INFO_NULL ) );
+    mpiSafeCall( MPI_File_read_all( fh, localData, 1, dd->_localDatatype, 
+          MPI_STATUS_IGNORE ) );
+  } catch ( std::exception& ){
+    MPI_File_close( &fh );
+    throw;
   }
+  mpiSafeCall( MPI_File_close( &fh ) );
+}
+
+template <typename T>
+void CartSplitter::writeDistributed( const std::string& filename,
+    const std::vector<T>& localData, const DistributedDescription<T> * dd,
+    MPI_Offset displacement ){
+  writeDistributed( filename, localData.data(), localData.size(), dd, displacement );
+}
+
+template <typename T>
+void CartSplitter::writeDistributed( const std::string& filename,
+    const T * localData, size_t localSize, 
+    const DistributedDescription<T> * dd, MPI_Offset displacement ){
+
+  checkBufferSize( localSize, dd->getLocalSize(), "writeDistributed" );
 
+  MPI_File fh;
+  mpiSafeCall( MPI_File_open( _comm, filename.c_str(), 
+        MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &fh ) );
+  try {
+    mpiSafeCall( MPI_File_set_view( fh, displacement, dd->_elementType, 
+          dd->_types[_cartRank], "native", MPI_INFO_NULL ) );
+    mpiSafeCall( MPI_File_write_all( fh, localData, 1, dd->_localDatatype, 
+          MPI_STATUS_IGNORE ) );
+  } catch ( std::exception& ){
+    MPI_File_close( &fh );
+    throw;
+  }
+  mpiSafeCall( MPI_File_close( &fh ) );
 }
 
 template <typename T>
 void CartSplitter::haloUpdate( std::vector<T>& localData, 
           const DistributedDescription<T> * dd ){
+  haloUpdate( localData.data(), localData.size(), dd );
+}
+
+template <typename T>
+void CartSplitter::haloUpdate( T * localData, size_t localSize,
+          const DistributedDescription<T> * dd ){
+
+  checkBufferSize( localSize, dd->getLocalSize(), "haloUpdate" );
+
+  if ( dd->_haloMode == HaloMode::Sweep ){
+    MPI_Request requests[4];
+    for( unsigned int dim = 0; dim < _dims.size(); ++dim ){
+      int n = postSweepPhase( localData, dd, dim, requests, false );
+      mpiSafeCall( MPI_Waitall( n, requests, MPI_STATUSES_IGNORE ) );
+    }
+    return;
+  }
+
+  if ( dd->_haloEngine == HaloEngine::Threaded ){
+    dd->acquireStaging();
+    try {
+      threadedExchange( localData, dd );
+    } catch ( std::exception& ){
+      dd->releaseStaging();
+      throw;
+    }
+    dd->releaseStaging();
+    return;
+  }
+
+  if ( dd->_haloEngine == HaloEngine::Aggregated && _coreDims.empty() )
+    throw std::runtime_error
+      ("CartSplitter::haloUpdate(): HaloEngine::Aggregated requires a two level grid");
+
+  if ( dd->_haloEngine == HaloEngine::Packed 
+      || dd->_haloEngine == HaloEngine::Aggregated ){
+    std::vector< MPI_Request > requests;
+    dd->acquireStaging();
+    try {
+      postPacked( localData, dd, requests, false );
+      if ( dd->_haloEngine == HaloEngine::Aggregated )
+        exchangeBlocks( dd );
+      if ( !requests.empty() )
+        mpiSafeCall( MPI_Waitall( requests.size(), &requests[0], 
+              MPI_STATUSES_IGNORE ) );
+      dd->unpackHalos( localData );
+    } catch ( std::exception& ){
+      dd->releaseStaging();
+      throw;
+    }
+    dd->releaseStaging();
+    return;
+  }
+
+  if ( dd->_haloEngine == HaloEngine::Neighborhood ){
+    mpiSafeCall( MPI_Neighbor_alltoallw( localData, 
+          dd->_nbrSendCounts.data(), dd->_nbrSendDispls.data(), 
+          dd->_nbrSendTypes.data(), localData, 
+          dd->_nbrRecvCounts.data(), dd->_nbrRecvDispls.data(), 
+          dd->_nbrRecvTypes.data(), graphComm( dd->_stencil ) ) );
+    return;
+  }
   
   for( unsigned int ii = 0; ii < _directions.size(); ++ii ){
+        if ( !dd->_activeDirections[ii] )
+          continue;
+
         MPI_Status status;
         int sendcnt = 0, recvcnt = 0;
         MPI_Datatype sendtype = MPI_INT, recvtype = MPI_INT;
@@ -459,14 +1546,1085 @@ void CartSplitter::haloUpdate( std::vector<T>& localData,
            recvtype = dd->_receiveTypes[ii];
         }
 
-        mpiSafeCall( MPI_Sendrecv( &localData[0], sendcnt, sendtype, 
+        mpiSafeCall( MPI_Sendrecv( localData, sendcnt, sendtype, 
               _destNeighbours[ii], 11, 
-              &localData[0], recvcnt, recvtype, _srcNeighbours[ii], 11,  
+              localData, recvcnt, recvtype, _srcNeighbours[ii], 11,  
               _comm, &status) );
       }
       
 
 }
 
-#endif // CARTSPLITTER_HPP
+template <typename T>
+HaloRequest CartSplitter::haloUpdateBegin( std::vector<T>& localData, 
+          const DistributedDescription<T> * dd ){
+  return haloUpdateBegin( localData.data(), localData.size(), dd );
+}
+
+template <typename T>
+HaloRequest CartSplitter::haloUpdateBegin( T * localData, size_t localSize,
+          const DistributedDescription<T> * dd ){
+
+  checkBufferSize( localSize, dd->getLocalSize(), "haloUpdateBegin" );
+
+  if ( dd->_haloMode == HaloMode::Direct 
+      && dd->_haloEngine == HaloEngine::Aggregated && _coreDims.empty() )
+    throw std::runtime_error
+      ("CartSplitter::haloUpdateBegin(): HaloEngine::Aggregated requires a two level grid");
+
+  HaloRequest request;
+
+  if ( dd->_haloMode == HaloMode::Sweep ){
+    // phases depend on each other: only last one is left in flight
+    MPI_Request requests[4];
+    const int last = _dims.size() - 1;
+    for( int dim = 0; dim < last; ++dim ){
+      int n = postSweepPhase( localData, dd, dim, requests, false );
+      mpiSafeCall( MPI_Waitall( n, requests, MPI_STATUSES_IGNORE ) );
+    }
+    int n = postSweepPhase( localData, dd, last, requests, false );
+    request._requests.assign( requests, requests + n );
+    return request;
+  }
+
+  if ( dd->_haloEngine == HaloEngine::Packed 
+      || dd->_haloEngine == HaloEngine::Aggregated 
+      || dd->_haloEngine == HaloEngine::Threaded ){
+    // exchange between blocks completes here, within blocks is left in 
+    // flight: staging buffers are released by completion
+    dd->acquireStaging();
+    try {
+      postPacked( localData, dd, request._requests, false );
+      if ( dd->_haloEngine == HaloEngine::Aggregated )
+        exchangeBlocks( dd );
+    } catch ( std::exception& ){
+      dd->releaseStaging();
+      throw;
+    }
+    request._completion = &DistributedDescription<T>::unpackHalosCallback;
+    request._localData = localData;
+    request._dd = dd;
+    return request;
+  }
+
+  if ( dd->_haloEngine == HaloEngine::Neighborhood ){
+    MPI_Request req;
+    mpiSafeCall( MPI_Ineighbor_alltoallw( localData, 
+          dd->_nbrSendCounts.data(), dd->_nbrSendDispls.data(), 
+          dd->_nbrSendTypes.data(), localData, 
+          dd->_nbrRecvCounts.data(), dd->_nbrRecvDispls.data(), 
+          dd->_nbrRecvTypes.data(), graphComm( dd->_stencil ), &req ) );
+    request._requests.push_back( req );
+    return request;
+  }
+
+  request._requests.reserve( 2 * _directions.size() );
+
+  // receives first, so that incoming messages find a matching buffer 
+  for( unsigned int ii = 0; ii < _directions.size(); ++ii ){
+    if ( _srcNeighbours[ii] == MPI_PROC_NULL || !dd->_activeDirections[ii] )
+      continue;
+
+    int recvcnt = 0;
+    MPI_Datatype recvtype = MPI_INT;
+    if ( dd->_receiveTypes[ii] != 0 ){
+      recvcnt = 1;
+      recvtype = dd->_receiveTypes[ii];
+    }
+
+    MPI_Request req;
+    mpiSafeCall( MPI_Irecv( localData, recvcnt, recvtype, 
+          _srcNeighbours[ii], 11, _comm, &req ) );
+    request._requests.push_back( req );
+  }
+
+  for( unsigned int ii = 0; ii < _directions.size(); ++ii ){
+    if ( _destNeighbours[ii] == MPI_PROC_NULL || !dd->_activeDirections[ii] )
+      continue;
+
+    int sendcnt = 0;
+    MPI_Datatype sendtype = MPI_INT;
+    if ( dd->_sendTypes[ii] != 0 ){
+      sendcnt = 1;
+      sendtype = dd->_sendTypes[ii];
+    }
+
+    MPI_Request req;
+    mpiSafeCall( MPI_Isend( localData, sendcnt, sendtype, 
+          _destNeighbours[ii], 11, _comm, &req ) );
+    request._requests.push_back( req );
+  }
+
+  return request;
+}
+
+template <typename T, typename Kernel>
+void CartSplitter::haloUpdateOverlap( std::vector<T>& localData, 
+          const DistributedDescription<T> * dd, Kernel kernel ){
+  haloUpdateOverlap( localData.data(), localData.size(), dd, kernel );
+}
 
+template <typename T, typename Kernel>
+void CartSplitter::haloUpdateOverlap( T * localData, size_t localSize,
+          const DistributedDescription<T> * dd, Kernel kernel ){
+
+  HaloRequest request = haloUpdateBegin( localData, localSize, dd );
+
+  const LocalRegion& interior = dd->getInteriorRegion();
+  if ( vector_helper::prod( interior.size ) > 0 )
+    kernel( interior );
+
+  haloUpdateEnd( request );
+
+  const std::vector< LocalRegion >& boundary = dd->getBoundaryRegions();
+  for( unsigned int ii = 0; ii < boundary.size(); ++ii )
+    kernel( boundary[ii] );
+}
+
+template <typename T>
+HaloPlan* CartSplitter::createHaloPlan( std::vector<T>& localData, 
+          const DistributedDescription<T> * dd ){
+  return createHaloPlan( localData.data(), localData.size(), dd );
+}
+
+template <typename T>
+HaloPlan* CartSplitter::createHaloPlan( T * localData, size_t localSize,
+          const DistributedDescription<T> * dd ){
+
+  checkBufferSize( localSize, dd->getLocalSize(), "createHaloPlan" );
+
+  if ( dd->_haloMode == HaloMode::Direct 
+      && dd->_haloEngine == HaloEngine::Aggregated )
+    throw std::runtime_error
+      ("CartSplitter::createHaloPlan() does not support HaloEngine::Aggregated");
+
+  HaloPlan * plan = new HaloPlan();
+
+  if ( dd->_haloMode == HaloMode::Sweep ){
+    MPI_Request requests[4];
+    try {
+      for( unsigned int dim = 0; dim < _dims.size(); ++dim ){
+        int n = postSweepPhase( localData, dd, dim, requests, true );
+        plan->_phaseStarts.push_back( plan->_requests.size() );
+        plan->_requests.insert( plan->_requests.end(), requests, requests + n );
+      }
+    } catch ( std::exception& ){
+      delete plan;
+      throw;
+    }
+    return plan;
+  }
+
+  if ( dd->_haloEngine == HaloEngine::Packed 
+      || dd->_haloEngine == HaloEngine::Threaded ){
+    try {
+      postPacked( localData, dd, plan->_requests, true );
+    } catch ( std::exception& ){
+      delete plan;
+      throw;
+    }
+    plan->_preparation = &DistributedDescription<T>::packHalosCallback;
+    plan->_completion = &DistributedDescription<T>::unpackHalosCallback;
+    plan->_localData = localData;
+    plan->_dd = dd;
+    return plan;
+  }
+
+#if MPI_VERSION >= 4
+  if ( dd->_haloEngine == HaloEngine::Neighborhood ){
+    MPI_Request req;
+    try {
+      mpiSafeCall( MPI_Neighbor_alltoallw_init( localData, 
+            dd->_nbrSendCounts.data(), dd->_nbrSendDispls.data(), 
+            dd->_nbrSendTypes.data(), localData, 
+            dd->_nbrRecvCounts.data(), dd->_nbrRecvDispls.data(), 
+            dd->_nbrRecvTypes.data(), graphComm( dd->_stencil ), MPI_INFO_NULL, &req ) );
+    } catch ( std::exception& ){
+      delete plan;
+      throw;
+    }
+    plan->_requests.push_back( req );
+    return plan;
+  }
+#endif
+  // persistent collectives need MPI-4: before that, neighborhood
+  // engine falls back to persistent point to point requests 
+
+  plan->_requests.reserve( 2 * _directions.size() );
+
+  try {
+    // receives first, as in haloUpdateBegin
+    for( unsigned int ii = 0; ii < _directions.size(); ++ii ){
+      if ( _srcNeighbours[ii] == MPI_PROC_NULL || !dd->_activeDirections[ii] )
+        continue;
+
+      int recvcnt = 0;
+      MPI_Datatype recvtype = MPI_INT;
+      if ( dd->_receiveTypes[ii] != 0 ){
+        recvcnt = 1;
+        recvtype = dd->_receiveTypes[ii];
+      }
+
+      MPI_Request req;
+      mpiSafeCall( MPI_Recv_init( localData, recvcnt, recvtype, 
+            _srcNeighbours[ii], 11, _comm, &req ) );
+      plan->_requests.push_back( req );
+    }
+
+    for( unsigned int ii = 0; ii < _directions.size(); ++ii ){
+      if ( _destNeighbours[ii] == MPI_PROC_NULL || !dd->_activeDirections[ii] )
+        continue;
+
+      int sendcnt = 0;
+      MPI_Datatype sendtype = MPI_INT;
+      if ( dd->_sendTypes[ii] != 0 ){
+        sendcnt = 1;
+        sendtype = dd->_sendTypes[ii];
+      }
+
+      MPI_Request req;
+      mpiSafeCall( MPI_Send_init( localData, sendcnt, sendtype, 
+            _destNeighbours[ii], 11, _comm, &req ) );
+      plan->_requests.push_back( req );
+    }
+  } catch ( std::exception& ){
+    delete plan;
+    throw;
+  }
+
+  return plan;
+}
+
+template <typename T>
+void CartSplitter::haloUpdate( const std::vector< std::vector<T>* >& fields, 
+          const DistributedDescription<T> * dd ){
+
+  if ( fields.empty() )
+    return;
+
+  HaloPlan * plan = createHaloPlan( fields, dd );
+  try {
+    plan->update();
+  } catch ( std::exception& ){
+    delete plan;
+    throw;
+  }
+  delete plan;
+}
+
+template <typename T>
+HaloPlan* CartSplitter::createHaloPlan( 
+    const std::vector< std::vector<T>* >& fields, 
+    const DistributedDescription<T> * dd ){
+
+  std::vector< MPI_Aint > addresses( fields.size() );
+  for( unsigned int ff = 0; ff < fields.size(); ++ff ){
+    if ( fields[ff]->size() != dd->getLocalSize() )
+      throw std::runtime_error
+        ("CartSplitter::createHaloPlan() field size mismatch");
+    mpiSafeCall( MPI_Get_address( &(*fields[ff])[0], &addresses[ff] ) );
+  }
+
+  HaloPlan * plan = new HaloPlan();
+
+  try {
+    if ( dd->_haloMode == HaloMode::Sweep ){
+      for( unsigned int dim = 0; dim < _dims.size(); ++dim ){
+        plan->_phaseStarts.push_back( plan->_requests.size() );
+        for( int face = 2*dim; face < int( 2*dim + 2 ); ++face ){
+          int ii = _faceDirections[face];
+          initFieldsExchange( addresses, dd->_sweepSendTypes[face], 
+              dd->_sweepReceiveTypes[face], _destNeighbours[ii], 
+              _srcNeighbours[ii], plan );
+        }
+      }
+    }
+    else {
+      for( unsigned int ii = 0; ii < _directions.size(); ++ii ){
+        if ( dd->_activeDirections[ii] )
+          initFieldsExchange( addresses, dd->_sendTypes[ii], 
+              dd->_receiveTypes[ii], _destNeighbours[ii], 
+              _srcNeighbours[ii], plan );
+      }
+    }
+  } catch ( std::exception& ){
+    delete plan;
+    throw;
+  }
+
+  return plan;
+}
+
+template <typename T>
+SharedHalo<T>* CartSplitter::createSharedHalo( 
+    const DistributedDescription<T> * dd ){
+
+  if ( dd->_haloMode != HaloMode::Direct )
+    throw std::runtime_error
+      ("CartSplitter::createSharedHalo() requires HaloMode::Direct");
+
+  const int D = _dims.size();
+  const int C = dd->_components;
+
+  SharedHalo<T> * sh = new SharedHalo<T>();
+
+  try {
+    sh->_nodeComm = _nodeComm;
+    sh->_size = dd->getLocalSize();
+    mpiSafeCall( MPI_Win_allocate_shared( sh->_size * sizeof(T), sizeof(T),
+          MPI_INFO_NULL, _nodeComm, &sh->_data, &sh->_win ) );
+    mpiSafeCall( MPI_Win_lock_all( MPI_MODE_NOCHECK, sh->_win ) );
+
+    // local geometry of nodes sharing memory
+    int nodeSize;
+    mpiSafeCall( MPI_Comm_size( _nodeComm, &nodeSize ) );
+    std::vector<int> geometry( dd->_localDims );
+    geometry.insert( geometry.end(), dd->_localExtents.begin(), dd->_localExtents.end() );
+    geometry.insert( geometry.end(), dd->_localStarts.begin(), dd->_localStarts.end() );
+    geometry.insert( geometry.end(), dd->_localSubSizes.begin(), dd->_localSubSizes.end() );
+    std::vector<int> nodeGeometry( 4 * D * nodeSize );
+    mpiSafeCall( MPI_Allgather( &geometry[0], 4*D, MPI_INT, 
+          &nodeGeometry[0], 4*D, MPI_INT, _nodeComm ) );
+
+    // components are copied as an additional contiguous dimension
+    std::vector<int> dstDims( dd->_localDims );
+    if ( C > 1 )
+      dstDims.push_back( C );
+
+    std::vector<int> srcStart, srcSize, dstStart, dstSize;
+    for( unsigned int ii = 0; ii < _directions.size(); ++ii ){
+      if ( !dd->_activeDirections[ii] )
+        continue;
+
+      if ( _srcNeighbours[ii] != MPI_PROC_NULL ){
+        int nodeRank = _srcNodeNeighbours[ii];
+        if ( nodeRank != MPI_UNDEFINED ){
+          std::vector<int>::const_iterator g = nodeGeometry.begin() + 4*D*nodeRank;
+          std::vector<int> srcDims( g, g + D ), srcExtents( g + D, g + 2*D ),
+            srcStarts( g + 2*D, g + 3*D ), srcSubSizes( g + 3*D, g + 4*D );
+
+          // neighbour send region, in neighbour buffer
+          dd->haloRegion( _directions[ii], true, srcExtents, srcStarts, srcSubSizes,
+              srcStart, srcSize );
+          dd->haloRegion( _directions[ii], false, dstStart, dstSize );
+          if ( srcSize != dstSize )
+            throw std::runtime_error
+              ("CartSplitter::createSharedHalo() halo size mismatch");
+          if ( vector_helper::prod( dstSize ) == 0 )
+            continue;
+
+          if ( C > 1 ){
+            srcDims.push_back( C ); srcStart.push_back( 0 );
+            dstStart.push_back( 0 ); dstSize.push_back( C );
+          }
+
+          MPI_Aint segSize;
+          int dispUnit;
+          T * base;
+          mpiSafeCall( MPI_Win_shared_query( sh->_win, nodeRank, &segSize,
+                &dispUnit, &base ) );
+
+          typename SharedHalo<T>::LocalCopy c;
+          c.src = base + pack_helper::offset( srcDims, srcStart );
+          c.srcDims = srcDims;
+          c.dst = sh->_data + pack_helper::offset( dstDims, dstStart );
+          c.dstDims = dstDims;
+          c.size = dstSize;
+          sh->_copies.push_back( c );
+        }
+        else {
+          int recvcnt = 0;
+          MPI_Datatype recvtype = MPI_INT;
+          if ( dd->_receiveTypes[ii] != 0 ){
+            recvcnt = 1;
+            recvtype = dd->_receiveTypes[ii];
+          }
+
+          MPI_Request req;
+          mpiSafeCall( MPI_Recv_init( sh->_data, recvcnt, recvtype, 
+                _srcNeighbours[ii], 11, _comm, &req ) );
+          sh->_requests.push_back( req );
+        }
+      }
+
+      if ( _destNeighbours[ii] != MPI_PROC_NULL 
+          && _destNodeNeighbours[ii] == MPI_UNDEFINED ){
+        int sendcnt = 0;
+        MPI_Datatype sendtype = MPI_INT;
+        if ( dd->_sendTypes[ii] != 0 ){
+          sendcnt = 1;
+          sendtype = dd->_sendTypes[ii];
+        }
+
+        MPI_Request req;
+        mpiSafeCall( MPI_Send_init( sh->_data, sendcnt, sendtype, 
+              _destNeighbours[ii], 11, _comm, &req ) );
+        sh->_requests.push_back( req );
+      }
+    }
+  } catch ( std::exception& ){
+    delete sh;
+    throw;
+  }
+
+  return sh;
+}
+
+template <typename T>
+RmaHalo* CartSplitter::createRmaHalo( std::vector<T>& localData,
+    const DistributedDescription<T> * dd ){
+  return createRmaHalo( localData.data(), localData.size(), dd );
+}
+
+template <typename T>
+RmaHalo* CartSplitter::createRmaHalo( T * localData, size_t localSize,
+    const DistributedDescription<T> * dd ){
+
+  checkBufferSize( localSize, dd->getLocalSize(), "createRmaHalo" );
+
+  if ( dd->_haloMode != HaloMode::Direct )
+    throw std::runtime_error
+      ("CartSplitter::createRmaHalo() requires HaloMode::Direct");
+
+  const int D = _dims.size();
+  const int Ndirs = _directions.size();
+
+  RmaHalo * rma = new RmaHalo();
+
+  try {
+    rma->_data = localData;
+    mpiSafeCall( MPI_Win_create( localData, localSize * sizeof(T), 
+          sizeof(T), MPI_INFO_NULL, _comm, &rma->_win ) );
+
+    // local geometry of destination neighbours ( targets of puts )
+    std::vector<int> geometry( dd->_localDims );
+    geometry.insert( geometry.end(), dd->_localExtents.begin(), dd->_localExtents.end() );
+    geometry.insert( geometry.end(), dd->_localStarts.begin(), dd->_localStarts.end() );
+    geometry.insert( geometry.end(), dd->_localSubSizes.begin(), dd->_localSubSizes.end() );
+    std::vector<int> destGeometry( 4 * D * Ndirs, 0 );
+    for( int ii = 0; ii < Ndirs; ++ii ){
+      if ( !dd->_activeDirections[ii] )
+        continue;
+      mpiSafeCall( MPI_Sendrecv( &geometry[0], 4*D, MPI_INT, _srcNeighbours[ii], 12,
+            &destGeometry[ 4*D*ii ], 4*D, MPI_INT, _destNeighbours[ii], 12, 
+            _comm, MPI_STATUS_IGNORE ) );
+    }
+
+    std::vector<int> origins, targets;
+    std::vector<int> start, size;
+    for( int ii = 0; ii < Ndirs; ++ii ){
+      if ( !dd->_activeDirections[ii] )
+        continue;
+
+      if ( _srcNeighbours[ii] != MPI_PROC_NULL && dd->_receiveTypes[ii] != 0 )
+        origins.push_back( _srcNeighbours[ii] );
+
+      if ( _destNeighbours[ii] == MPI_PROC_NULL || dd->_sendTypes[ii] == 0 )
+        continue;
+
+      // receive region, in destination buffer
+      std::vector<int>::const_iterator g = destGeometry.begin() + 4*D*ii;
+      std::vector<int> destDims( g, g + D ), destExtents( g + D, g + 2*D ),
+        destStarts( g + 2*D, g + 3*D ), destSubSizes( g + 3*D, g + 4*D );
+      dd->haloRegion( _directions[ii], false, destExtents, destStarts, destSubSizes,
+          start, size );
+
+      RmaHalo::Put put;
+      put.target = _destNeighbours[ii];
+      dd->createRegionType( destDims, start, size, put.targetType );
+      if ( put.targetType == 0 )
+        throw std::runtime_error("CartSplitter::createRmaHalo() halo size mismatch");
+      // own copy: rma may outlive dd
+      mpiSafeCall( MPI_Type_dup( dd->_sendTypes[ii], &put.originType ) );
+      rma->_puts.push_back( put );
+      targets.push_back( _destNeighbours[ii] );
+    }
+
+    // groups need distinct ranks
+    std::sort( origins.begin(), origins.end() );
+    origins.erase( std::unique( origins.begin(), origins.end() ), origins.end() );
+    std::sort( targets.begin(), targets.end() );
+    targets.erase( std::unique( targets.begin(), targets.end() ), targets.end() );
+
+    MPI_Group cartGroup;
+    mpiSafeCall( MPI_Comm_group( _comm, &cartGroup ) );
+    mpiSafeCall( MPI_Group_incl( cartGroup, origins.size(), origins.data(), 
+          &rma->_originGroup ) );
+    mpiSafeCall( MPI_Group_incl( cartGroup, targets.size(), targets.data(), 
+          &rma->_targetGroup ) );
+    mpiSafeCall( MPI_Group_free( &cartGroup ) );
+  } catch ( std::exception& ){
+    delete rma;
+    throw;
+  }
+
+  return rma;
+}
+
+template <typename T>
+HaloLocality CartSplitter::haloLocality( 
+    const DistributedDescription<T> * dd ) const {
+
+  long long bytes[2] = { 0, 0 }; // intra node, inter node
+
+  const bool sweep = dd->_haloMode == HaloMode::Sweep;
+  const unsigned int count = sweep ? dd->_sweepSendTypes.size() : _directions.size();
+  for( unsigned int jj = 0; jj < count; ++jj ){
+    int ii = sweep ? _faceDirections[jj] : jj;
+    MPI_Datatype sendtype = sweep ? dd->_sweepSendTypes[jj] : dd->_sendTypes[ii];
+    if ( _destNeighbours[ii] == MPI_PROC_NULL || sendtype == 0 
+        || ( !sweep && !dd->_activeDirections[ii] ) )
+      continue;
+
+    int size;
+    mpiSafeCall( MPI_Type_size( sendtype, &size ) );
+    bytes[ _destNodeNeighbours[ii] == MPI_UNDEFINED ] += size;
+  }
+
+  mpiSafeCall( MPI_Allreduce( MPI_IN_PLACE, bytes, 2, MPI_LONG_LONG, 
+        MPI_SUM, _comm ) );
+
+  HaloLocality locality;
+  locality.intraNode = bytes[0];
+  locality.interNode = bytes[1];
+  return locality;
+}
+
+template <typename T>
+int CartSplitter::postSweepPhase( T * localData, 
+          const DistributedDescription<T> * dd, int dim,
+          MPI_Request * requests, bool persistent ){
+
+  int n = 0;
+
+  // receives first, as in haloUpdateBegin
+  for( int face = 2*dim; face < 2*dim + 2; ++face ){
+    int ii = _faceDirections[face];
+    if ( _srcNeighbours[ii] == MPI_PROC_NULL )
+      continue;
+
+    int recvcnt = 0;
+    MPI_Datatype recvtype = MPI_INT;
+    if ( dd->_sweepReceiveTypes[face] != 0 ){
+      recvcnt = 1;
+      recvtype = dd->_sweepReceiveTypes[face];
+    }
+
+    if ( persistent )
+      mpiSafeCall( MPI_Recv_init( localData, recvcnt, recvtype, 
+            _srcNeighbours[ii], 11, _comm, &requests[n++] ) );
+    else
+      mpiSafeCall( MPI_Irecv( localData, recvcnt, recvtype, 
+            _srcNeighbours[ii], 11, _comm, &requests[n++] ) );
+  }
+
+  for( int face = 2*dim; face < 2*dim + 2; ++face ){
+    int ii = _faceDirections[face];
+    if ( _destNeighbours[ii] == MPI_PROC_NULL )
+      continue;
+
+    int sendcnt = 0;
+    MPI_Datatype sendtype = MPI_INT;
+    if ( dd->_sweepSendTypes[face] != 0 ){
+      sendcnt = 1;
+      sendtype = dd->_sweepSendTypes[face];
+    }
+
+    if ( persistent )
+      mpiSafeCall( MPI_Send_init( localData, sendcnt, sendtype, 
+            _destNeighbours[ii], 11, _comm, &requests[n++] ) );
+    else
+      mpiSafeCall( MPI_Isend( localData, sendcnt, sendtype, 
+            _destNeighbours[ii], 11, _comm, &requests[n++] ) );
+  }
+
+  return n;
+}
+
+template <typename T>
+void CartSplitter::postPacked( T * localData, 
+          const DistributedDescription<T> * dd, 
+          std::vector< MPI_Request >& requests, bool persistent ){
+
+  if ( dd->_sendBuffer.size() != dd->_sendOffsets.back() 
+      || dd->_receiveBuffer.size() != dd->_receiveOffsets.back() )
+    throw std::runtime_error
+      ("CartSplitter: staging buffers not allocated, use setHaloEngine()");
+
+  requests.reserve( requests.size() + 2 * _directions.size() );
+
+  // regions crossing blocks go through block leaders
+  const bool aggregated = dd->_haloEngine == HaloEngine::Aggregated;
+
+  // receives first, as in haloUpdateBegin
+  for( unsigned int ii = 0; ii < _directions.size(); ++ii ){
+    if ( _srcNeighbours[ii] == MPI_PROC_NULL || !dd->_activeDirections[ii] 
+        || ( aggregated && _srcBlockNeighbours[ii] == MPI_UNDEFINED ) )
+      continue;
+
+    T * buffer = dd->_receiveBuffer.data() + dd->_receiveOffsets[ii];
+    int count = dd->_receiveOffsets[ii+1] - dd->_receiveOffsets[ii];
+
+    MPI_Request req;
+    if ( persistent )
+      mpiSafeCall( MPI_Recv_init( buffer, count, mpi_info<T>::mpi_datatype, 
+            _srcNeighbours[ii], 11, _comm, &req ) );
+    else
+      mpiSafeCall( MPI_Irecv( buffer, count, mpi_info<T>::mpi_datatype, 
+            _srcNeighbours[ii], 11, _comm, &req ) );
+    requests.push_back( req );
+  }
+
+  if ( !persistent )
+    dd->packHalos( localData );
+
+  for( unsigned int ii = 0; ii < _directions.size(); ++ii ){
+    if ( _destNeighbours[ii] == MPI_PROC_NULL || !dd->_activeDirections[ii] 
+        || ( aggregated && _destBlockNeighbours[ii] == MPI_UNDEFINED ) )
+      continue;
+
+    T * buffer = dd->_sendBuffer.data() + dd->_sendOffsets[ii];
+    int count = dd->_sendOffsets[ii+1] - dd->_sendOffsets[ii];
+
+    MPI_Request req;
+    if ( persistent )
+      mpiSafeCall( MPI_Send_init( buffer, count, mpi_info<T>::mpi_datatype, 
+            _destNeighbours[ii], 11, _comm, &req ) );
+    else
+      mpiSafeCall( MPI_Isend( buffer, count, mpi_info<T>::mpi_datatype, 
+            _destNeighbours[ii], 11, _comm, &req ) );
+    requests.push_back( req );
+  }
+}
+
+template <typename T>
+void CartSplitter::fillBlockExchange( DistributedDescription<T> * dd ){
+
+  // regions crossing blocks: ( neighbour, direction, size ), in direction order
+  std::vector<int> sendInfo, recvInfo, lens, displs;
+  for( unsigned int ii = 0; ii < _directions.size(); ++ii ){
+    if ( _destNeighbours[ii] == MPI_PROC_NULL || !dd->_activeDirections[ii] 
+        || _destBlockNeighbours[ii] != MPI_UNDEFINED )
+      continue;
+    int count = dd->_sendOffsets[ii+1] - dd->_sendOffsets[ii];
+    int info[3] = { _destNeighbours[ii], (int) ii, count };
+    sendInfo.insert( sendInfo.end(), info, info + 3 );
+    lens.push_back( count );
+    displs.push_back( dd->_sendOffsets[ii] );
+  }
+  mpiSafeCall( MPI_Type_indexed( lens.size(), lens.data(), displs.data(),
+        mpi_info<T>::mpi_datatype, &dd->_blockSendType ) );
+  mpiSafeCall( MPI_Type_commit( &dd->_blockSendType ) );
+
+  lens.clear(); displs.clear();
+  for( unsigned int ii = 0; ii < _directions.size(); ++ii ){
+    if ( _srcNeighbours[ii] == MPI_PROC_NULL || !dd->_activeDirections[ii] 
+        || _srcBlockNeighbours[ii] != MPI_UNDEFINED )
+      continue;
+    int count = dd->_receiveOffsets[ii+1] - dd->_receiveOffsets[ii];
+    int info[3] = { _srcNeighbours[ii], (int) ii, count };
+    recvInfo.insert( recvInfo.end(), info, info + 3 );
+    lens.push_back( count );
+    displs.push_back( dd->_receiveOffsets[ii] );
+  }
+  mpiSafeCall( MPI_Type_indexed( lens.size(), lens.data(), displs.data(),
+        mpi_info<T>::mpi_datatype, &dd->_blockRecvType ) );
+  mpiSafeCall( MPI_Type_commit( &dd->_blockRecvType ) );
+
+  // regions of all members to block leader
+  int blockRank, blockSize;
+  mpiSafeCall( MPI_Comm_rank( _blockComm, &blockRank ) );
+  mpiSafeCall( MPI_Comm_size( _blockComm, &blockSize ) );
+
+  int sizes[2] = { (int) sendInfo.size(), (int) recvInfo.size() };
+  std::vector<int> allSizes( 2 * blockSize );
+  mpiSafeCall( MPI_Gather( sizes, 2, MPI_INT, allSizes.data(), 2, MPI_INT, 
+        0, _blockComm ) );
+
+  std::vector<int> sendCounts( blockSize ), sendDispls( blockSize + 1, 0 ), 
+    recvCounts( blockSize ), recvDispls( blockSize + 1, 0 );
+  for( int mm = 0; mm < blockSize; ++mm ){
+    sendCounts[mm] = allSizes[2*mm];
+    recvCounts[mm] = allSizes[2*mm+1];
+    sendDispls[mm+1] = sendDispls[mm] + sendCounts[mm];
+    recvDispls[mm+1] = recvDispls[mm] + recvCounts[mm];
+  }
+  std::vector<int> allSends( sendDispls.back() + 1 ), allRecvs( recvDispls.back() + 1 );
+  mpiSafeCall( MPI_Gatherv( sendInfo.data(), sendInfo.size(), MPI_INT, 
+        allSends.data(), sendCounts.data(), sendDispls.data(), MPI_INT, 
+        0, _blockComm ) );
+  mpiSafeCall( MPI_Gatherv( recvInfo.data(), recvInfo.size(), MPI_INT, 
+        allRecvs.data(), recvCounts.data(), recvDispls.data(), MPI_INT, 
+        0, _blockComm ) );
+
+  if ( blockRank != 0 )
+    return;
+
+  // message to each neighbour block: regions ordered by ( member, direction ),
+  // members regions are contiguous in _gatherBuffer
+  typedef std::pair< std::pair<int,int>, std::pair<int,int> > Region; // (peer,order),(offset,size)
+  std::vector< Region > regions;
+  dd->_gatherCounts.assign( blockSize, 0 );
+  dd->_gatherDispls.assign( blockSize, 0 );
+  int offset = 0;
+  for( int mm = 0; mm < blockSize; ++mm ){
+    dd->_gatherDispls[mm] = offset;
+    for( int rr = sendDispls[mm]; rr < sendDispls[mm+1]; rr += 3 ){
+      int peer, member;
+      blockPosition( allSends[rr], peer, member );
+      regions.push_back( Region( std::make_pair( peer, 
+              mm * _directions.size() + allSends[rr+1] ), 
+            std::make_pair( offset, allSends[rr+2] ) ) );
+      offset += allSends[rr+2];
+    }
+    dd->_gatherCounts[mm] = offset - dd->_gatherDispls[mm];
+  }
+  std::sort( regions.begin(), regions.end() );
+
+  for( unsigned int first = 0, last = 0; first < regions.size(); first = last ){
+    lens.clear(); displs.clear();
+    for( last = first; last < regions.size() 
+        && regions[last].first.first == regions[first].first.first; ++last ){
+      displs.push_back( regions[last].second.first );
+      lens.push_back( regions[last].second.second );
+    }
+    MPI_Datatype type;
+    mpiSafeCall( MPI_Type_indexed( lens.size(), lens.data(), displs.data(),
+          mpi_info<T>::mpi_datatype, &type ) );
+    mpiSafeCall( MPI_Type_commit( &type ) );
+    dd->_peerDests.push_back( regions[first].first.first );
+    dd->_peerSendTypes.push_back( type );
+  }
+
+  // message from each neighbour block: same order, seen from the source
+  regions.clear();
+  dd->_scatterCounts.assign( blockSize, 0 );
+  dd->_scatterDispls.assign( blockSize, 0 );
+  offset = 0;
+  for( int mm = 0; mm < blockSize; ++mm ){
+    dd->_scatterDispls[mm] = offset;
+    for( int rr = recvDispls[mm]; rr < recvDispls[mm+1]; rr += 3 ){
+      int peer, member;
+      blockPosition( allRecvs[rr], peer, member );
+      regions.push_back( Region( std::make_pair( peer, 
+              member * _directions.size() + allRecvs[rr+1] ), 
+            std::make_pair( offset, allRecvs[rr+2] ) ) );
+      offset += allRecvs[rr+2];
+    }
+    dd->_scatterCounts[mm] = offset - dd->_scatterDispls[mm];
+  }
+  std::sort( regions.begin(), regions.end() );
+
+  for( unsigned int first = 0, last = 0; first < regions.size(); first = last ){
+    lens.clear(); displs.clear();
+    for( last = first; last < regions.size() 
+        && regions[last].first.first == regions[first].first.first; ++last ){
+      displs.push_back( regions[last].second.first );
+      lens.push_back( regions[last].second.second );
+    }
+    MPI_Datatype type;
+    mpiSafeCall( MPI_Type_indexed( lens.size(), lens.data(), displs.data(),
+          mpi_info<T>::mpi_datatype, &type ) );
+    mpiSafeCall( MPI_Type_commit( &type ) );
+    dd->_peerSources.push_back( regions[first].first.first );
+    dd->_peerRecvTypes.push_back( type );
+  }
+}
+
+template <typename T>
+void CartSplitter::exchangeBlocks( const DistributedDescription<T> * dd ){
+
+  if ( dd->_gatherBuffer.size() != (size_t) 
+      ( dd->_gatherCounts.empty() ? 0 : dd->_gatherDispls.back() + dd->_gatherCounts.back() ) )
+    throw std::runtime_error
+      ("CartSplitter: staging buffers not allocated, use setHaloEngine()");
+
+  mpiSafeCall( MPI_Gatherv( dd->_sendBuffer.data(), 1, dd->_blockSendType, 
+        dd->_gatherBuffer.data(), dd->_gatherCounts.data(), 
+        dd->_gatherDispls.data(), mpi_info<T>::mpi_datatype, 0, _blockComm ) );
+
+  // block leader only: a message for each neighbour block
+  std::vector< MPI_Request > requests( dd->_peerSources.size() 
+      + dd->_peerDests.size() );
+  for( unsigned int pp = 0; pp < dd->_peerSources.size(); ++pp )
+    mpiSafeCall( MPI_Irecv( dd->_scatterBuffer.data(), 1, dd->_peerRecvTypes[pp], 
+          dd->_peerSources[pp], 13, _comm, &requests[pp] ) );
+  for( unsigned int pp = 0; pp < dd->_peerDests.size(); ++pp )
+    mpiSafeCall( MPI_Isend( dd->_gatherBuffer.data(), 1, dd->_peerSendTypes[pp], 
+          dd->_peerDests[pp], 13, _comm, &requests[ dd->_peerSources.size() + pp ] ) );
+  if ( !requests.empty() )
+    mpiSafeCall( MPI_Waitall( requests.size(), &requests[0], 
+          MPI_STATUSES_IGNORE ) );
+
+  mpiSafeCall( MPI_Scatterv( dd->_scatterBuffer.data(), dd->_scatterCounts.data(),
+        dd->_scatterDispls.data(), mpi_info<T>::mpi_datatype, 
+        dd->_receiveBuffer.data(), 1, dd->_blockRecvType, 0, _blockComm ) );
+}
+
+template <typename T, typename Kernel>
+void CartSplitter::parallelForInterior( const DistributedDescription<T> * dd, 
+    Kernel kernel, bool boundaryFirst, size_t tileBytes ){
+
+  const std::vector< LocalRegion > tiles = dd->getTiles( tileBytes );
+
+  // one pass, or tiles reading halos then the others
+  std::vector< std::vector<int> > passes( 1 );
+  if ( boundaryFirst ){
+    passes.resize( 2 );
+    for( unsigned int tt = 0; tt < tiles.size(); ++tt )
+      passes[ dd->readsHalos( tiles[tt] ) ? 0 : 1 ].push_back( tt );
+  }
+  else
+    for( unsigned int tt = 0; tt < tiles.size(); ++tt )
+      passes[0].push_back( tt );
+
+  for( unsigned int pp = 0; pp < passes.size(); ++pp ){
+    const std::vector<int>& pass = passes[pp];
+    if ( _pool )
+      _pool->parallelFor( pass.size(), [&]( int kk ){ kernel( tiles[ pass[kk] ] ); } );
+    else
+      for( unsigned int kk = 0; kk < pass.size(); ++kk )
+        kernel( tiles[ pass[kk] ] );
+  }
+}
+
+template <typename T>
+void CartSplitter::threadedExchange( T * localData, 
+          const DistributedDescription<T> * dd ){
+
+  if ( dd->_sendBuffer.size() != dd->_sendOffsets.back() 
+      || dd->_receiveBuffer.size() != dd->_receiveOffsets.back() )
+    throw std::runtime_error
+      ("CartSplitter: staging buffers not allocated, use setHaloEngine()");
+
+  // largest directions first, each to the least loaded thread
+  const int Ndirs = _directions.size();
+  const int threads = getHaloThreads();
+  std::vector< std::pair<size_t, int> > sizes;
+  for( int ii = 0; ii < Ndirs; ++ii )
+    if ( dd->_activeDirections[ii] && ( _srcNeighbours[ii] != MPI_PROC_NULL 
+          || _destNeighbours[ii] != MPI_PROC_NULL ) )
+      sizes.push_back( std::make_pair( dd->_sendOffsets[ii+1] - dd->_sendOffsets[ii] 
+            + dd->_receiveOffsets[ii+1] - dd->_receiveOffsets[ii], ii ) );
+  std::sort( sizes.rbegin(), sizes.rend() );
+
+  std::vector< std::vector<int> > owned( threads );
+  std::vector< size_t > load( threads, 0 );
+  for( unsigned int kk = 0; kk < sizes.size(); ++kk ){
+    int tt = std::min_element( load.begin(), load.end() ) - load.begin();
+    owned[tt].push_back( sizes[kk].second );
+    load[tt] += sizes[kk].first;
+  }
+
+  // a tag for each direction: messages of different threads never mix
+  std::vector< MPI_Request > requests( 2 * Ndirs, MPI_REQUEST_NULL );
+  MPI_Comm comm = _comm;
+  const std::vector<int>& src = _srcNeighbours;
+  const std::vector<int>& dest = _destNeighbours;
+
+  auto postRecv = [&]( int ii ){
+    if ( src[ii] != MPI_PROC_NULL )
+      mpiSafeCall( MPI_Irecv( dd->_receiveBuffer.data() + dd->_receiveOffsets[ii],
+            dd->_receiveOffsets[ii+1] - dd->_receiveOffsets[ii], 
+            mpi_info<T>::mpi_datatype, src[ii], 100 + ii, comm, &requests[2*ii] ) );
+  };
+  auto postSend = [&]( int ii ){
+    if ( dest[ii] != MPI_PROC_NULL )
+      mpiSafeCall( MPI_Isend( dd->_sendBuffer.data() + dd->_sendOffsets[ii],
+            dd->_sendOffsets[ii+1] - dd->_sendOffsets[ii], 
+            mpi_info<T>::mpi_datatype, dest[ii], 100 + ii, comm, &requests[2*ii+1] ) );
+  };
+
+  if ( _threadMultiple ){
+    // each thread runs the whole exchange of its directions
+    auto exchange = [&]( int tt ){
+      const std::vector<int>& mine = owned[tt];
+      for( unsigned int kk = 0; kk < mine.size(); ++kk )
+        postRecv( mine[kk] );
+      for( unsigned int kk = 0; kk < mine.size(); ++kk ){
+        dd->packHalo( localData, mine[kk] );
+        postSend( mine[kk] );
+      }
+      for( unsigned int kk = 0; kk < mine.size(); ++kk ){
+        mpiSafeCall( MPI_Waitall( 2, &requests[ 2*mine[kk] ], MPI_STATUSES_IGNORE ) );
+        dd->unpackHalo( localData, mine[kk] );
+      }
+    };
+    if ( _pool )
+      _pool->run( exchange );
+    else
+      exchange( 0 );
+    return;
+  }
+
+  // funneled: threads pack and unpack, calling thread communicates
+  auto pack = [&]( int tt ){
+    for( unsigned int kk = 0; kk < owned[tt].size(); ++kk )
+      dd->packHalo( localData, owned[tt][kk] );
+  };
+  auto unpack = [&]( int tt ){
+    for( unsigned int kk = 0; kk < owned[tt].size(); ++kk )
+      dd->unpackHalo( localData, owned[tt][kk] );
+  };
+
+  for( unsigned int kk = 0; kk < sizes.size(); ++kk )
+    postRecv( sizes[kk].second );
+  if ( _pool )
+    _pool->run( pack );
+  else
+    pack( 0 );
+  for( unsigned int kk = 0; kk < sizes.size(); ++kk )
+    postSend( sizes[kk].second );
+  mpiSafeCall( MPI_Waitall( requests.size(), &requests[0], MPI_STATUSES_IGNORE ) );
+  if ( _pool )
+    _pool->run( unpack );
+  else
+    unpack( 0 );
+}
+
+template <typename T>
+MPI_Datatype CartSplitter::createNodeType( const DistributedDescription<T> * dd,
+    int leader ) const {
+
+  std::vector<int> blocks;
+  std::vector<MPI_Aint> displs;
+  std::vector<MPI_Datatype> types;
+  for( int node = 0; node < _cartSize; ++node ){
+    if ( _nodeLeaders[node] != leader )
+      continue;
+    blocks.push_back( 1 );
+    displs.push_back( 0 );
+    types.push_back( dd->_types[node] );
+  }
+
+  MPI_Datatype nodeType;
+  mpiSafeCall( MPI_Type_create_struct( types.size(), &blocks[0], &displs[0],
+        &types[0], &nodeType ) );
+  mpiSafeCall( MPI_Type_commit( &nodeType ) );
+  return nodeType;
+}
+
+template <typename T>
+T * CartSplitter::nodeBuffer( const DistributedDescription<T> * dd,
+    int * count, size_t * offset ){
+  using vector_helper::prod;
+
+  // internal portions of node members, in rank order
+  const int leader = _nodeLeaders[_cartRank];
+  *count = 0;
+  *offset = 0;
+  for( int node = 0; node < _cartSize; ++node ){
+    if ( _nodeLeaders[node] != leader )
+      continue;
+    if ( node == _cartRank )
+      *offset = *count * dd->_components;
+    *count += prod( dd->_subSizes[node] );
+  }
+
+  reserveNodeWindow( *count * dd->_components * sizeof(T) );
+  return static_cast< T* >( _nodeBase );
+}
+
+template <typename T>
+void CartSplitter::scatterHierarchical( const T * data,
+    T * localData, int root,
+    const DistributedDescription<T> * dd ){
+
+  // root: a single message for each shared memory node
+  std::vector< MPI_Request > requests;
+  if ( root == _cartRank ){
+    requests.reserve( _cartSize );
+    for( int leader = 0; leader < _cartSize; ++leader ){
+      if ( _nodeLeaders[leader] != leader )
+        continue;
+      MPI_Datatype nodeType = createNodeType( dd, leader );
+      requests.push_back( MPI_REQUEST_NULL );
+      mpiSafeCall( MPI_Isend( data, 1, nodeType, leader, 333, _comm, 
+            &requests.back() ) );
+      mpiSafeCall( MPI_Type_free( &nodeType ) );
+    }
+  }
+
+  int count;
+  size_t offset;
+  T * buffer = nodeBuffer( dd, &count, &offset );
+  MPI_Win win = _nodeWin;
+
+  if ( _nodeLeaders[_cartRank] == _cartRank )
+    mpiSafeCall( MPI_Recv( buffer, count, dd->_elementType, root, 
+          333, _comm, MPI_STATUS_IGNORE ) );
+
+  // leader writes visible
+  mpiSafeCall( MPI_Win_sync( win ) );
+  mpiSafeCall( MPI_Barrier( _nodeComm ) );
+  mpiSafeCall( MPI_Win_sync( win ) );
+
+  std::vector<int> dims( dd->_localDims ), start( dd->_localStarts ), 
+    size( dd->_localSubSizes );
+  if ( dd->_components > 1 ){
+    dims.push_back( dd->_components );
+    start.push_back( 0 );
+    size.push_back( dd->_components );
+  }
+  pack_helper::unpack( buffer + offset, localData, dims, start, size );
+
+  // node members done with their loads
+  mpiSafeCall( MPI_Barrier( _nodeComm ) );
+
+  if ( !requests.empty() )
+    mpiSafeCall( MPI_Waitall( requests.size(), &requests[0], 
+          MPI_STATUSES_IGNORE ) );
+}
+
+template <typename T>
+void CartSplitter::gatherHierarchical( const T * localData, 
+    T * newData, int root, 
+    const DistributedDescription<T> * dd ){
+
+  // root: a single message from each shared memory node
+  std::vector< MPI_Request > requests;
+  if ( root == _cartRank ){
+    requests.reserve( _cartSize );
+    for( int leader = 0; leader < _cartSize; ++leader ){
+      if ( _nodeLeaders[leader] != leader )
+        continue;
+      MPI_Datatype nodeType = createNodeType( dd, leader );
+      requests.push_back( MPI_REQUEST_NULL );
+      mpiSafeCall( MPI_Irecv( newData, 1, nodeType, leader, 666, _comm, 
+            &requests.back() ) );
+      mpiSafeCall( MPI_Type_free( &nodeType ) );
+    }
+  }
+
+  int count;
+  size_t offset;
+  T * buffer = nodeBuffer( dd, &count, &offset );
+  MPI_Win win = _nodeWin;
+
+  std::vector<int> dims( dd->_localDims ), start( dd->_localStarts ), 
+    size( dd->_localSubSizes );
+  if ( dd->_components > 1 ){
+    dims.push_back( dd->_components );
+    start.push_back( 0 );
+    size.push_back( dd->_components );
+  }
+  pack_helper::pack( localData, dims, start, size, buffer + offset );
+
+  // node members writes visible to leader
+  mpiSafeCall( MPI_Win_sync( win ) );
+  mpiSafeCall( MPI_Barrier( _nodeComm ) );
+  mpiSafeCall( MPI_Win_sync( win ) );
+
+  if ( _nodeLeaders[_cartRank] == _cartRank )
+    mpiSafeCall( MPI_Send( buffer, count, dd->_elementType, root, 
+          666, _comm ) );
+
+  // leader done with the buffer before it is reused
+  mpiSafeCall( MPI_Barrier( _nodeComm ) );
+
+  if ( !requests.empty() )
+    mpiSafeCall( MPI_Waitall( requests.size(), &requests[0], 
+          MPI_STATUSES_IGNORE ) );
+}
+
+#endif // CARTSPLITTER_HPP
@@ -10,6 +10,8 @@
 #ifndef DISTRIBUTED_DESCRIPTION_HPP
 #define DISTRIBUTED_DESCRIPTION_HPP
 
+#include <algorithm>
+
 #include "mpi.h"
 
 template <typename T>
@@ -18,11 +20,37 @@ class DistributedDescription;
 #include "CartSplitter.hpp"
 #include "vector_helper.hpp"
 #include "mpi_info.hpp"
+#include "pack_helper.hpp"
+#include "aligned_allocator.hpp"
 
 struct HaloType {
     enum type { Unused=0, Full=1, Tight=2 };
 };
 
+struct HaloMode {
+    enum type { Direct=0, Sweep=1 };
+};
+
+struct StencilShape {
+    enum type { Box=0, Star=1 };
+};
+
+struct HaloEngine {
+    enum type { PointToPoint=0, Neighborhood=1, Packed=2, Aggregated=3, Threaded=4 };
+};
+
+struct CollectiveMode {
+    enum type { Flat=0, Hierarchical=1 };
+};
+
+/**
+ * Box in local data: first index and size for each dimension
+ */
+struct LocalRegion {
+    std::vector<int> start;
+    std::vector<int> size;
+};
+
 /**
  * This class provides a description of
  * the blocking procedure used to distribute data
@@ -33,6 +61,8 @@ class DistributedDescription {
   private:
    // overall description: used by root in scatter/gather 
    std::vector< int > _dims;          //!< overall data dimension 
+   int _components;                   //!< number of T values in each element
+   MPI_Datatype _elementType;         //!< MPI type of a single element
    std::vector< std::vector< int > > _subSizes; //!< internal size, for each node 
    std::vector< std::vector< int > > _starts;   //!< start of internal size, for each node
 
@@ -42,7 +72,8 @@ class DistributedDescription {
    std::vector< int > _haloPost; //!< requested halo size after internal part
 
    // local description 
-   std::vector< int > _localDims;  //! local size (internal + halos )
+   std::vector< int > _localDims;  //! local size (internal + halos + row padding )
+   std::vector< int > _localExtents;  //! local size without row padding
    std::vector< int > _localSubSizes; //! internal size
    std::vector< int > _localStarts;   //! start of internal size in local data
 
@@ -51,19 +82,109 @@ class DistributedDescription {
 
    MPI_Datatype _localDatatype; //!< MPI types to be used in scatter/gather by not root 
 
+   // directions exchanged ( 0 if not needed by stencil )
+   std::vector< char > _activeDirections;
+   StencilShape::type _stencil;  //!< Star: faces only
+
    // halo types ( in same order as given directions )
    std::vector< MPI_Datatype > _sendTypes;    
    std::vector< MPI_Datatype > _receiveTypes;
 
+   HaloMode::type _haloMode;     //!< direct or dimension sweep exchange
+   HaloEngine::type _haloEngine; //!< engine used for halo exchange
+
+   // dimension sweep types ( face 2*d is direction -1 on d, 2*d+1 is +1 on d )
+   std::vector< MPI_Datatype > _sweepSendTypes;    
+   std::vector< MPI_Datatype > _sweepReceiveTypes;
+
+   // neighborhood collective arguments ( in same order as graph neighbours )
+   std::vector< int > _nbrSendCounts;
+   std::vector< MPI_Aint > _nbrSendDispls;
+   std::vector< MPI_Datatype > _nbrSendTypes;
+   std::vector< int > _nbrRecvCounts;
+   std::vector< MPI_Aint > _nbrRecvDispls;
+   std::vector< MPI_Datatype > _nbrRecvTypes;
+
+   // explicit packing regions ( in same order as given directions, 
+   // zero sizes where there is no neighbour )
+   std::vector< std::vector<int> > _sendStarts;
+   std::vector< std::vector<int> > _sendSizes;
+   std::vector< std::vector<int> > _receiveStarts;
+   std::vector< std::vector<int> > _receiveSizes;
+   std::vector< size_t > _sendOffsets;    //!< offset of each direction in _sendBuffer
+   std::vector< size_t > _receiveOffsets; //!< offset of each direction in _receiveBuffer
+   std::vector< int > _packDims; //!< local dims, components appended as last dimension
+
+   // staging buffers, allocated when HaloEngine::Packed is selected
+   mutable std::vector< T > _sendBuffer;
+   mutable std::vector< T > _receiveBuffer;
+   mutable bool _stagingBusy;  //!< an exchange is using staging buffers
+
+   // exchange between blocks of a two level grid through block leaders
+   // ( HaloEngine::Aggregated ): regions of staging buffers crossing blocks
+   MPI_Datatype _blockSendType;  //!< regions of _sendBuffer for other blocks
+   MPI_Datatype _blockRecvType;  //!< regions of _receiveBuffer from other blocks
+   // block leader only: members regions and one message for each neighbour block
+   std::vector< int > _gatherCounts;  //!< values sent by each member
+   std::vector< int > _gatherDispls;  //!< offset of each member in _gatherBuffer
+   std::vector< int > _scatterCounts; //!< values received by each member
+   std::vector< int > _scatterDispls; //!< offset of each member in _scatterBuffer
+   std::vector< int > _peerDests;     //!< leaders of blocks receiving from this block
+   std::vector< int > _peerSources;   //!< leaders of blocks sending to this block
+   std::vector< MPI_Datatype > _peerSendTypes; //!< regions of _gatherBuffer for each dest
+   std::vector< MPI_Datatype > _peerRecvTypes; //!< regions of _scatterBuffer from each source
+   mutable std::vector< T > _gatherBuffer;
+   mutable std::vector< T > _scatterBuffer;
+
+   // flat scatter/gather as a single MPI_Alltoallw, arguments built on
+   // first use and rebuilt only when root changes: root side exchanges
+   // a block with each node, member side only its local type with root
+   mutable int _collRoot;                          //!< root of arguments, -1 if none
+   mutable std::vector< int > _rootCounts;         //!< 1 for each node on root
+   mutable std::vector< MPI_Datatype > _rootTypes; //!< _types on root
+   mutable std::vector< int > _memberCounts;       //!< 1 for root only
+   mutable std::vector< MPI_Datatype > _memberTypes; //!< _localDatatype for root
+   mutable std::vector< int > _collDispls;         //!< all zero
+
+   // internal portion split for overlap of exchange and computation
+   LocalRegion _interior;                 //!< cells not reading halos
+   std::vector< LocalRegion > _boundary;  //!< disjoint shells around _interior
+
 
    // constructor is private, CartSplitter is a friend
    friend class CartSplitter;
 
-   DistributedDescription( const std::vector<int>& dims ) 
-     : _dims( dims ), _subSizes(0), _starts(0), _types(0),
-       _haloPre(0), _haloPost(0), _localDims(0), _localSubSizes(0),
+   DistributedDescription( const std::vector<int>& dims, int components = 1 ) 
+     : _dims( dims ), _components( components ), 
+       _elementType( mpi_info<T>::mpi_datatype ), _subSizes(0), _starts(0), _types(0),
+       _haloPre(0), _haloPost(0), _localDims(0), _localExtents(0), _localSubSizes(0),
        _localStarts(0), _localHaloPre(0), _localHaloPost(0), _localDatatype(0),
-       _sendTypes(0), _receiveTypes(0) {};
+       _activeDirections(0), _stencil( StencilShape::Box ),
+       _sendTypes(0), _receiveTypes(0), _haloMode( HaloMode::Direct ),
+       _haloEngine( HaloEngine::PointToPoint ),
+       _sweepSendTypes(0), _sweepReceiveTypes(0),
+       _nbrSendCounts(0), _nbrSendDispls(0), _nbrSendTypes(0),
+       _nbrRecvCounts(0), _nbrRecvDispls(0), _nbrRecvTypes(0),
+       _sendStarts(0), _sendSizes(0), _receiveStarts(0), _receiveSizes(0),
+       _sendOffsets(0), _receiveOffsets(0), _packDims(0),
+       _sendBuffer(0), _receiveBuffer(0), _stagingBusy(false),
+       _blockSendType( MPI_DATATYPE_NULL ), _blockRecvType( MPI_DATATYPE_NULL ),
+       _gatherCounts(0), _gatherDispls(0), _scatterCounts(0), _scatterDispls(0),
+       _peerDests(0), _peerSources(0), _peerSendTypes(0), _peerRecvTypes(0),
+       _gatherBuffer(0), _scatterBuffer(0), _collRoot(-1),
+       _rootCounts(0), _rootTypes(0), _memberCounts(0), _memberTypes(0),
+       _collDispls(0), _interior(), _boundary(0) {
+
+     if ( _components < 1 )
+       throw std::runtime_error("DistributedDescription: components must be positive");
+
+     // interleaved components: an element is a contiguous block of T 
+     if ( _components > 1 ){
+       mpiSafeCall( MPI_Type_contiguous( _components, mpi_info<T>::mpi_datatype,
+             &_elementType ) );
+       mpiSafeCall( MPI_Type_commit( &_elementType ) );
+     }
+   };
    
    void fillInternalTypes();
   
@@ -72,17 +193,139 @@ class DistributedDescription {
        const std::vector<int>& coords, 
        const std::vector<int>& gridDims ); 
 
-   void fillLocalSizes( int rank ); 
+   void fillLocalSizes( int rank, int rowAlign ); 
 
    void fillLocalType(); 
 
+   void haloRegion( const std::vector<int>& off, bool send,
+       const std::vector<int>& localExtents, const std::vector<int>& localStarts,
+       const std::vector<int>& localSubSizes,
+       std::vector<int>& start_coo, std::vector<int>& halo_size ) const;
+
+   void haloRegion( const std::vector<int>& off, bool send,
+       std::vector<int>& start_coo, std::vector<int>& halo_size ) const {
+     haloRegion( off, send, _localExtents, _localStarts, _localSubSizes, 
+         start_coo, halo_size );
+   }
+
+   void createRegionType( const std::vector<int>& localDims,
+       const std::vector<int>& start_coo, const std::vector<int>& halo_size, 
+       MPI_Datatype& type ) const;
+
+   void createRegionType( const std::vector<int>& start_coo,
+       const std::vector<int>& halo_size, MPI_Datatype& type ) const {
+     createRegionType( _localDims, start_coo, halo_size, type );
+   }
+
+   void fillActiveDirections ( const std::vector< std::vector<int> >& dirs,
+       StencilShape::type stencil );
+
    void fillHaloTypes ( const std::vector< std::vector<int> >& dirs ); 
 
+   void fillSweepTypes ( bool extended ); 
+
+   void fillNeighborhoodArgs ( const std::vector<int>& srcNeighbours,
+       const std::vector<int>& destNeighbours );
+
+   void fillPackedRegions ( const std::vector< std::vector<int> >& dirs,
+       const std::vector<int>& srcNeighbours,
+       const std::vector<int>& destNeighbours );
+
+   void fillOverlapRegions ();
+
+   void fillCollectiveArgs ( int root, int rank ) const;
+
+   /**
+    * Packs send regions of all directions in _sendBuffer
+    * @param localData local buffer
+    */
+   void packHalos( const T* localData ) const;
+
+   /**
+    * Unpacks _receiveBuffer in receive regions of all directions 
+    * @param localData local buffer
+    */
+   void unpackHalos( T* localData ) const;
+
+   /**
+    * Packs send region of a direction in _sendBuffer
+    * @param localData local buffer
+    * @param ii direction index
+    */
+   void packHalo( const T* localData, int ii ) const {
+     if ( _sendOffsets[ii+1] > _sendOffsets[ii] )
+       pack_helper::pack( localData, _packDims, _sendStarts[ii], 
+           _sendSizes[ii], &_sendBuffer[ _sendOffsets[ii] ] );
+   }
+
+   /**
+    * Unpacks receive region of a direction from _receiveBuffer
+    * @param localData local buffer
+    * @param ii direction index
+    */
+   void unpackHalo( T* localData, int ii ) const {
+     if ( _receiveOffsets[ii+1] > _receiveOffsets[ii] )
+       pack_helper::unpack( &_receiveBuffer[ _receiveOffsets[ii] ], localData, 
+           _packDims, _receiveStarts[ii], _receiveSizes[ii] );
+   }
+
+   /**
+    * Marks staging buffers as used by an exchange, until releaseStaging()
+    *
+    * Throws if another exchange ( blocking, HaloRequest or HaloPlan ) 
+    * is still using them.
+    */
+   void acquireStaging() const {
+     if ( _stagingBusy )
+       throw std::runtime_error("DistributedDescription: staging buffers "
+           "in use by another halo exchange on this description");
+     _stagingBusy = true;
+   }
+
+   void releaseStaging() const { _stagingBusy = false; }
+
+   // type erased versions, for HaloRequest and HaloPlan: packing
+   // starts an exchange on staging buffers, unpacking ends it
+   static void packHalosCallback( void * localData, const void * dd ) {
+     const DistributedDescription<T> * self = 
+       static_cast< const DistributedDescription<T>* >( dd );
+     self->acquireStaging();
+     self->packHalos( static_cast< const T* >( localData ) );
+   }
+
+   static void unpackHalosCallback( void * localData, const void * dd ) {
+     const DistributedDescription<T> * self = 
+       static_cast< const DistributedDescription<T>* >( dd );
+     self->unpackHalos( static_cast< T* >( localData ) );
+     self->releaseStaging();
+   }
+
   public:
     ~DistributedDescription () {
     
       try {
 
+        for( unsigned int ii = 0; ii < _peerRecvTypes.size(); ++ii )
+          mpiSafeCall( MPI_Type_free( &_peerRecvTypes[ii] ) );
+
+        for( unsigned int ii = 0; ii < _peerSendTypes.size(); ++ii )
+          mpiSafeCall( MPI_Type_free( &_peerSendTypes[ii] ) );
+
+        if ( _blockRecvType != MPI_DATATYPE_NULL )
+          mpiSafeCall( MPI_Type_free( &_blockRecvType ) );
+        if ( _blockSendType != MPI_DATATYPE_NULL )
+          mpiSafeCall( MPI_Type_free( &_blockSendType ) );
+
+        for( unsigned int ii = 0; ii < _sweepReceiveTypes.size(); ++ii ){
+          if ( _sweepReceiveTypes[ii] != 0 )
+            mpiSafeCall( MPI_Type_free( &_sweepReceiveTypes[ii] ) );
+        } 
+
+        for( unsigned int ii = 0; ii < _sweepSendTypes.size(); ++ii ){
+          if ( _sweepSendTypes[ii] != 0 )
+            mpiSafeCall( MPI_Type_free( &_sweepSendTypes[ii] ) );
+        } 
+
         for( unsigned int ii = 0; ii < _receiveTypes.size(); ++ii ){
           if ( _receiveTypes[ii] != 0 )
             mpiSafeCall( MPI_Type_free( &_receiveTypes[ii] ) );
@@ -99,6 +342,9 @@ class DistributedDescription {
           if ( _types[ii] != 0 )
             mpiSafeCall( MPI_Type_free( &_types[ii] ) );
         } 
+
+        if ( _components > 1 )
+          mpiSafeCall( MPI_Type_free( &_elementType ) );
       } catch ( std::exception &e ){
         std::cerr << "Errors on DistributedDescription dtor: " 
           << e.what() << std::endl;
@@ -107,34 +353,66 @@ class DistributedDescription {
     }; 
     
     /**
-     * Returns the number of elements (internal+halos) in local buffer
-     * @return number of elements 
+     * Returns the number of values (internal+halos) in local buffer
+     * @return number of elements times number of components
      */ 
     size_t getLocalSize() const { 
       using vector_helper::prod;
-      return prod ( _localDims );
+      return prod ( _localDims ) * _components;
+    }
+
+    /**
+     * Local buffer aligned to a cache line
+     */
+    typedef std::vector< T, aligned_allocator<T> > Buffer;
+
+    /**
+     * Allocates a local buffer, see getLocalSize()
+     * @return value initialized buffer, first value aligned to 64 bytes
+     *
+     * Use pointer and size overloads of CartSplitter methods on it.
+     */
+    Buffer createLocalBuffer() const {
+      return Buffer( getLocalSize(), T() );
     }
 
     /**
-     * Returns the number of elements that will be collected in
+     * Returns the number of values that will be collected in
      * gather ( sum of internal elements of all nodes).  
-     * @return number of elements 
+     * @return number of elements times number of components
      */
     size_t getTotalSize() const { 
       using vector_helper::prod;
-      return prod ( _dims );
+      return prod ( _dims ) * _components;
+    }
+
+    /**
+     * Returns the number of components of each element
+     * @return number of components (interleaved in buffers)
+     */
+    int getComponents() const {
+      return _components;
     }
 
 
     /**
      * Returns a handle to local dimension vector
-     * @return size for each dimension (last is contiguous dimension)
+     * @return size for each dimension (last is contiguous dimension,
+     * row padding included)
      */ 
     const std::vector<int>& getLocalDims() const {
         return _localDims;
     }
 
 
+    /**
+     * Returns a handle to local dimension vector, without row padding
+     * @return internal plus halo size for each dimension
+     */ 
+    const std::vector<int>& getLocalExtents() const {
+        return _localExtents;
+    }
+
     /**
      * Returns a handle to local internal dimension vector
      * @return size for each dimension (last is contiguous dimension)
@@ -143,6 +421,115 @@ class DistributedDescription {
         return _localSubSizes;
     } 
 
+    /**
+     * Returns a handle to start of internal part in local data
+     * @return start for each dimension (last is contiguous dimension)
+     */ 
+    const std::vector<int>& getLocalStarts() const {
+        return _localStarts;
+    } 
+
+    /**
+     * Returns the internal cells whose stencil ( reaching haloPre 
+     * before and haloPost after ) does not read halos
+     * @return region in local data ( possibly empty )
+     *
+     * Can be computed while a halo exchange is in progress.
+     */
+    const LocalRegion& getInteriorRegion() const {
+        return _interior;
+    }
+
+    /**
+     * Returns the internal cells not in interior region
+     * @return disjoint non empty regions in local data
+     *
+     * To be computed once halo exchange is completed.
+     */
+    const std::vector< LocalRegion >& getBoundaryRegions() const {
+        return _boundary;
+    }
+
+    /**
+     * Splits internal cells in tiles of about tileBytes bytes
+     * @param tileBytes target tile size ( in bytes )
+     * @return disjoint regions in local data covering internal cells, 
+     * in C order
+     *
+     * Rows are split only when longer than a tile; outer dimensions
+     * are then grouped, innermost first, up to tileBytes.
+     */
+    std::vector< LocalRegion > getTiles( size_t tileBytes ) const;
+
+    /**
+     * Checks whether a region of internal cells reads halos
+     * @param region region in local data
+     * @return true if region is not inside getInteriorRegion()
+     */
+    bool readsHalos( const LocalRegion& region ) const {
+        for( unsigned int dd = 0; dd < region.start.size(); ++dd )
+          if ( region.size[dd] > 0 && ( region.start[dd] < _interior.start[dd] 
+              || region.start[dd] + region.size[dd] 
+              > _interior.start[dd] + _interior.size[dd] ) )
+            return true;
+        return false;
+    }
+
+    /**
+     * Selects the engine used by CartSplitter for halo exchange
+     * @param engine HaloEngine::PointToPoint (default), 
+     * HaloEngine::Neighborhood, HaloEngine::Packed, 
+     * HaloEngine::Aggregated or HaloEngine::Threaded
+     *
+     * Used in HaloMode::Direct only: dimension sweep is always 
+     * point to point.
+     *
+     * HaloEngine::Packed copies halos through contiguous staging 
+     * buffers owned by this description: only one exchange at a 
+     * time can be in progress, starting another one ( blocking, 
+     * haloUpdateBegin or HaloPlan::start ) throws std::runtime_error.
+     *
+     * HaloEngine::Aggregated ( two level grids only ) packs as 
+     * HaloEngine::Packed; regions crossing blocks are collected by 
+     * block leaders, that send a single message to each neighbour 
+     * block.
+     *
+     * HaloEngine::Threaded ( see CartSplitter::setHaloThreads ) packs
+     * as HaloEngine::Packed, with directions spread over threads.
+     *
+     * HaloEngine::Neighborhood with StencilShape::Star runs on a graph
+     * of face neighbours only, so that no message is exchanged along
+     * edges and corners.
+     */
+    void setHaloEngine( HaloEngine::type engine ) {
+        _haloEngine = engine;
+        if ( ( engine == HaloEngine::Packed || engine == HaloEngine::Aggregated
+              || engine == HaloEngine::Threaded ) && !_sendOffsets.empty() ){
+          _sendBuffer.resize( _sendOffsets.back() );
+          _receiveBuffer.resize( _receiveOffsets.back() );
+        }
+        if ( engine == HaloEngine::Aggregated && !_gatherCounts.empty() ){
+          _gatherBuffer.resize( _gatherDispls.back() + _gatherCounts.back() );
+          _scatterBuffer.resize( _scatterDispls.back() + _scatterCounts.back() );
+        }
+    }
+
+    /**
+     * Returns the engine used for halo exchange
+     * @return halo engine
+     */
+    HaloEngine::type getHaloEngine() const {
+        return _haloEngine;
+    }
+
+    /**
+     * Returns the halo exchange mode
+     * @return halo mode
+     */
+    HaloMode::type getHaloMode() const {
+        return _haloMode;
+    }
+
 
 }; 
 
@@ -154,7 +541,7 @@ void DistributedDescription<T>::fillInternalTypes() {
 
   for ( int node = 0; node < cartSize; ++node ){
     mpiSafeCall( MPI_Type_create_subarray( _dims.size(), &_dims[0], &_subSizes[node][0], 
-          &_starts[node][0], MPI_ORDER_C, mpi_info<T>::mpi_datatype, &_types[node] ) );
+          &_starts[node][0], MPI_ORDER_C, _elementType, &_types[node] ) );
     mpiSafeCall( MPI_Type_commit( &_types[node] ) );
   }
 
@@ -194,117 +581,348 @@ void DistributedDescription<T>::fillHaloSizes( const std::vector<int>& haloPre,
    }
 
 template<typename T>
-void DistributedDescription<T>::fillLocalSizes( int rank ){
+void DistributedDescription<T>::fillLocalSizes( int rank, int rowAlign ){
      using vector_helper::operator+;
-     _localDims =  _subSizes[ rank ] + _localHaloPre + _localHaloPost ;
+     _localExtents =  _subSizes[ rank ] + _localHaloPre + _localHaloPost ;
      _localSubSizes = _subSizes[ rank ];
      _localStarts = _localHaloPre; 
+
+     // row pitch: last dimension rounded up to a multiple of rowAlign, 
+     // one more step if rows would be a multiple of 4 KiB apart
+     _localDims = _localExtents;
+     if ( rowAlign > 1 ){
+       int& pitch = _localDims.back();
+       pitch = ( ( pitch + rowAlign - 1 ) / rowAlign ) * rowAlign;
+       if ( _localDims.size() > 1 && ( pitch * _components * sizeof(T) ) % 4096 == 0 )
+         pitch += rowAlign;
+     }
    } 
 
 template<typename T>
 void DistributedDescription<T>::fillLocalType() {
      
      mpiSafeCall( MPI_Type_create_subarray( _localDims.size(), &_localDims[0],
-        &_localSubSizes[0], &_localStarts[0], MPI_ORDER_C, mpi_info<T>::mpi_datatype,
+        &_localSubSizes[0], &_localStarts[0], MPI_ORDER_C, _elementType,
         &_localDatatype ) ); 
      mpiSafeCall( MPI_Type_commit( &_localDatatype ) );
    
    }
 
 template<typename T>
-void DistributedDescription<T>::fillHaloTypes( 
-    const std::vector< std::vector<int> >& dirs ) {
-  using vector_helper::prod;
-  using vector_helper::operator-;
-
-  const int Ndirs = dirs.size();
-
-  // receive types
-  _receiveTypes.resize( Ndirs );
-  for( int ii = 0; ii < Ndirs; ++ii ){
+void DistributedDescription<T>::haloRegion( const std::vector<int>& off,
+    bool send, const std::vector<int>& localExtents, 
+    const std::vector<int>& localStarts, const std::vector<int>& localSubSizes,
+    std::vector<int>& start_coo, std::vector<int>& halo_size ) const {
 
-    _receiveTypes[ii] = 0; // default value for unused datatype
-    const std::vector<int>& off = dirs[ii];
+  const unsigned int D = off.size();
+  start_coo.resize( D );
+  halo_size.resize( D );
 
-    std::vector<int> start_coo ( off.size() );
-    for( unsigned int dd = 0; dd < off.size(); ++dd ){
+  for( unsigned int dd = 0; dd < D; ++dd ){
+    // one past last element in halo chunk
+    int end_coo;
+    if ( send ){
       switch ( off[dd] ){
-        case +1: start_coo[dd] = 0; break;
-        case  0: start_coo[dd] = _localStarts[dd]; break;
-        case -1: start_coo[dd] = _localStarts[dd] + _localSubSizes[dd]; break;
+        case -1: start_coo[dd] = localStarts[dd]; 
+                 end_coo = localStarts[dd] + _haloPost[dd]; break; 
+        case  0: start_coo[dd] = localStarts[dd]; 
+                 end_coo = localStarts[dd] + localSubSizes[dd]; break; 
+        case +1: start_coo[dd] = localStarts[dd] 
+                 + localSubSizes[dd] - _haloPre[dd]; 
+                 end_coo = localStarts[dd] + localSubSizes[dd]; break; 
         default:
                  throw std::runtime_error(" offset not handled"); 
       }
     }
-
-    // one past last element in halo chunk
-    std::vector<int> end_coo ( off.size() );
-    for( unsigned int dd = 0; dd < off.size(); ++dd ){
+    else {
       switch ( off[dd] ){
-        case +1: end_coo[dd] = _localStarts[dd]; break;
-        case  0: end_coo[dd] = _localStarts[dd] + _localSubSizes[dd]; break; 
-        case -1: end_coo[dd] = _localDims[dd]; break;
+        case +1: start_coo[dd] = 0; 
+                 end_coo = localStarts[dd]; break;
+        case  0: start_coo[dd] = localStarts[dd]; 
+                 end_coo = localStarts[dd] + localSubSizes[dd]; break; 
+        case -1: start_coo[dd] = localStarts[dd] + localSubSizes[dd]; 
+                 end_coo = localExtents[dd]; break;
         default:
                  throw std::runtime_error(" offset not handled"); 
       }
     }
+    halo_size[dd] = end_coo - start_coo[dd];
+  }
+}
 
+template<typename T>
+void DistributedDescription<T>::createRegionType( const std::vector<int>& localDims,
+    const std::vector<int>& start_coo, const std::vector<int>& halo_size, 
+    MPI_Datatype& type ) const {
+  using vector_helper::prod;
 
-    std::vector<int> halo_size = end_coo - start_coo;
-    if ( prod( halo_size ) ) { 
-      mpiSafeCall( MPI_Type_create_subarray( _localSubSizes.size(), 
-            &_localDims[0], &halo_size[0], 
-            &start_coo[0], MPI_ORDER_C, mpi_info<T>::mpi_datatype,
-            &_receiveTypes[ii] ) );
-      mpiSafeCall( MPI_Type_commit( &_receiveTypes[ii] ) );
-    }
+  type = 0; // default value for unused datatype
+  if ( prod( halo_size ) ) { 
+    mpiSafeCall( MPI_Type_create_subarray( localDims.size(), 
+          &localDims[0], &halo_size[0], 
+          &start_coo[0], MPI_ORDER_C, _elementType,
+          &type ) );
+    mpiSafeCall( MPI_Type_commit( &type ) );
+  }
+}
+
+template<typename T>
+void DistributedDescription<T>::fillActiveDirections( 
+    const std::vector< std::vector<int> >& dirs, StencilShape::type stencil ) {
+
+  _stencil = stencil;
+  _activeDirections.resize( dirs.size() );
+  for( unsigned int ii = 0; ii < dirs.size(); ++ii ){
+    int nonZero = 0;
+    for( unsigned int dd = 0; dd < dirs[ii].size(); ++dd )
+      nonZero += ( dirs[ii][dd] != 0 );
+    _activeDirections[ii] = ( stencil == StencilShape::Box || nonZero == 1 );
   }
+}
+
+template<typename T>
+void DistributedDescription<T>::fillHaloTypes( 
+    const std::vector< std::vector<int> >& dirs ) {
 
+  const int Ndirs = dirs.size();
+  std::vector<int> start_coo, halo_size;
+
+  // receive types
+  _receiveTypes.resize( Ndirs, 0 );
+  for( int ii = 0; ii < Ndirs; ++ii ){
+    if ( !_activeDirections[ii] )
+      continue;
+    haloRegion( dirs[ii], false, start_coo, halo_size );
+    createRegionType( start_coo, halo_size, _receiveTypes[ii] );
+  }
 
   // send types
-  _sendTypes.resize ( Ndirs ); 
+  _sendTypes.resize ( Ndirs, 0 ); 
   for( int ii = 0; ii < Ndirs; ++ii ){
+    if ( !_activeDirections[ii] )
+      continue;
+    haloRegion( dirs[ii], true, start_coo, halo_size );
+    createRegionType( start_coo, halo_size, _sendTypes[ii] );
+  } 
+}
 
-    _sendTypes[ii] = 0; // default value for unused datatype
+template<typename T>
+void DistributedDescription<T>::fillSweepTypes( bool extended ) {
 
-    const std::vector<int>& off = dirs[ii];
+  const int D = _localDims.size();
+  std::vector<int> start_coo, halo_size;
 
-    std::vector<int> start_coo ( off.size() );
-    for( unsigned int dd = 0; dd < off.size(); ++dd ){
-      switch ( off[dd] ){
-        case -1: start_coo[dd] = _localStarts[dd]; break;
-        case  0: start_coo[dd] = _localStarts[dd]; break;
-        case +1: start_coo[dd] = _localStarts[dd] 
-                 + _localSubSizes[dd] - _haloPre[dd]; break;
-        default:
-                 throw std::runtime_error(" offset not handled"); 
+  _sweepReceiveTypes.resize( 2*D );
+  _sweepSendTypes.resize( 2*D );
+
+  for( int face = 0; face < 2*D; ++face ){
+    const int dim = face / 2;
+    std::vector<int> off( D, 0 );
+    off[dim] = ( face % 2 ) ? +1 : -1;
+
+    for( int send = 0; send < 2; ++send ){
+      haloRegion( off, send, start_coo, halo_size );
+
+      // halos of previously swept dimensions travel along
+      for( int dd = 0; extended && dd < dim; ++dd ){
+        start_coo[dd] = 0;
+        halo_size[dd] = _localExtents[dd];
       }
+
+      createRegionType( start_coo, halo_size, 
+          send ? _sweepSendTypes[face] : _sweepReceiveTypes[face] );
     }
+  }
+}
 
-    // one past last element in halo chunk
-    std::vector<int> end_coo ( off.size() );
-    for( unsigned int dd = 0; dd < off.size(); ++dd ){
-      switch ( off[dd] ){
-        case -1: end_coo[dd] = _localStarts[dd] + _haloPost[dd]; break; 
-        case  0: end_coo[dd] = _localStarts[dd] + _localSubSizes[dd]; break; 
-        case +1: end_coo[dd] = _localStarts[dd] + _localSubSizes[dd]; break; 
-        default:
-                 throw std::runtime_error(" offset not handled"); 
-      }
+template<typename T>
+void DistributedDescription<T>::fillNeighborhoodArgs( 
+    const std::vector<int>& srcNeighbours,
+    const std::vector<int>& destNeighbours ) {
+
+  // neighbours are listed in direction order, skipping MPI_PROC_NULL
+  // and directions not in stencil ( see CartSplitter::graphComm ): 
+  // zero counts still need a valid datatype
+  for( unsigned int ii = 0; ii < srcNeighbours.size(); ++ii ){
+    if ( srcNeighbours[ii] == MPI_PROC_NULL || !_activeDirections[ii] )
+      continue;
+    bool used = _receiveTypes[ii] != 0;
+    _nbrRecvCounts.push_back( used ? 1 : 0 );
+    _nbrRecvDispls.push_back( 0 );
+    _nbrRecvTypes.push_back( used ? _receiveTypes[ii] : mpi_info<T>::mpi_datatype );
+  }
+
+  for( unsigned int ii = 0; ii < destNeighbours.size(); ++ii ){
+    if ( destNeighbours[ii] == MPI_PROC_NULL || !_activeDirections[ii] )
+      continue;
+    bool used = _sendTypes[ii] != 0;
+    _nbrSendCounts.push_back( used ? 1 : 0 );
+    _nbrSendDispls.push_back( 0 );
+    _nbrSendTypes.push_back( used ? _sendTypes[ii] : mpi_info<T>::mpi_datatype );
+  }
+}
+
+template<typename T>
+void DistributedDescription<T>::fillCollectiveArgs( int root, int rank ) const {
+
+  if ( root == _collRoot )
+    return;
+
+  // zero counts still need a valid datatype
+  const int cartSize = _types.size();
+  _collDispls.assign( cartSize, 0 );
+  _memberCounts.assign( cartSize, 0 );
+  _memberTypes.assign( cartSize, mpi_info<T>::mpi_datatype );
+  _memberCounts[root] = 1;
+  _memberTypes[root] = _localDatatype;
+
+  if ( rank == root ){
+    _rootCounts.assign( cartSize, 1 );
+    _rootTypes = _types;
+  } else {
+    _rootCounts.assign( cartSize, 0 );
+    _rootTypes.assign( cartSize, mpi_info<T>::mpi_datatype );
+  }
+
+  _collRoot = root;
+}
+
+template<typename T>
+void DistributedDescription<T>::fillPackedRegions( 
+    const std::vector< std::vector<int> >& dirs,
+    const std::vector<int>& srcNeighbours,
+    const std::vector<int>& destNeighbours ) {
+  using vector_helper::prod;
+
+  const int Ndirs = dirs.size();
+  const std::vector<int> empty( _localDims.size(), 0 );
+
+  // components are packed as an additional contiguous dimension
+  _packDims = _localDims;
+  if ( _components > 1 )
+    _packDims.push_back( _components );
+
+  _receiveStarts.resize( Ndirs );
+  _receiveSizes.resize( Ndirs );
+  _receiveOffsets.resize( Ndirs + 1 );
+  _receiveOffsets[0] = 0;
+  for( int ii = 0; ii < Ndirs; ++ii ){
+    if ( _activeDirections[ii] && srcNeighbours[ii] != MPI_PROC_NULL )
+      haloRegion( dirs[ii], false, _receiveStarts[ii], _receiveSizes[ii] );
+    else
+      _receiveStarts[ii] = _receiveSizes[ii] = empty;
+    if ( _components > 1 ){
+      _receiveStarts[ii].push_back( 0 );
+      _receiveSizes[ii].push_back( _components );
     }
+    _receiveOffsets[ii+1] = _receiveOffsets[ii] + prod( _receiveSizes[ii] );
+  }
 
+  _sendStarts.resize( Ndirs );
+  _sendSizes.resize( Ndirs );
+  _sendOffsets.resize( Ndirs + 1 );
+  _sendOffsets[0] = 0;
+  for( int ii = 0; ii < Ndirs; ++ii ){
+    if ( _activeDirections[ii] && destNeighbours[ii] != MPI_PROC_NULL )
+      haloRegion( dirs[ii], true, _sendStarts[ii], _sendSizes[ii] );
+    else
+      _sendStarts[ii] = _sendSizes[ii] = empty;
+    if ( _components > 1 ){
+      _sendStarts[ii].push_back( 0 );
+      _sendSizes[ii].push_back( _components );
+    }
+    _sendOffsets[ii+1] = _sendOffsets[ii] + prod( _sendSizes[ii] );
+  }
+}
+
+template<typename T>
+void DistributedDescription<T>::packHalos( const T* localData ) const {
+  for( unsigned int ii = 0; ii < _sendSizes.size(); ++ii )
+    packHalo( localData, ii );
+}
+
+template<typename T>
+void DistributedDescription<T>::unpackHalos( T* localData ) const {
+  for( unsigned int ii = 0; ii < _receiveSizes.size(); ++ii )
+    unpackHalo( localData, ii );
+}
+ 
+template<typename T>
+void DistributedDescription<T>::fillOverlapRegions() {
+
+  const int D = _localDims.size();
+
+  // interior: internal part shrunk by halos actually present
+  std::vector<int> lo( D ), hi( D );
+  _interior.start.resize( D );
+  _interior.size.resize( D );
+  for( int dd = 0; dd < D; ++dd ){
+    const int end = _localStarts[dd] + _localSubSizes[dd];
+    lo[dd] = std::min( _localStarts[dd] + _localHaloPre[dd], end );
+    hi[dd] = std::max( lo[dd], end - _localHaloPost[dd] );
+    _interior.start[dd] = lo[dd];
+    _interior.size[dd] = hi[dd] - lo[dd];
+  }
 
-    std::vector<int> halo_size = end_coo - start_coo;
-    if ( prod( halo_size ) ) { 
-      mpiSafeCall( MPI_Type_create_subarray( _localSubSizes.size(), 
-            &_localDims[0], &halo_size[0], 
-            &start_coo[0], MPI_ORDER_C, mpi_info<double>::mpi_datatype, 
-            &_sendTypes[ii] ) );
-      mpiSafeCall( MPI_Type_commit( &_sendTypes[ii] ) );
+  // shells: dimension dd peeled from a box interior on dimensions 
+  // before dd and internal on dimensions after dd
+  _boundary.clear();
+  for( int dd = 0; dd < D; ++dd ){
+    for( int side = 0; side < 2; ++side ){
+      LocalRegion shell;
+      shell.start = _localStarts;
+      shell.size = _localSubSizes;
+      for( int pp = 0; pp < dd; ++pp ){
+        shell.start[pp] = _interior.start[pp];
+        shell.size[pp] = _interior.size[pp];
+      }
+      if ( side == 0 )
+        shell.size[dd] = lo[dd] - _localStarts[dd];
+      else {
+        shell.start[dd] = hi[dd];
+        shell.size[dd] = _localStarts[dd] + _localSubSizes[dd] - hi[dd];
+      }
+
+      if ( vector_helper::prod( shell.size ) > 0 )
+        _boundary.push_back( shell );
     }
-  } 
+  }
 }
 
+template<typename T>
+std::vector< LocalRegion > DistributedDescription<T>::getTiles( 
+    size_t tileBytes ) const {
+
+  const int D = _localSubSizes.size();
+  std::vector< LocalRegion > tiles;
+  if ( vector_helper::prod( _localSubSizes ) == 0 )
+    return tiles;
+
+  // tile sizes: last dimension first
+  const size_t elementBytes = sizeof(T) * _components;
+  std::vector<int> tile( D ), counts( D );
+  size_t budget = std::max( tileBytes / elementBytes, size_t(1) );
+  for( int dd = D - 1; dd >= 0; --dd ){
+    tile[dd] = std::max( 1, (int) std::min( budget, (size_t) _localSubSizes[dd] ) );
+    budget = std::max( budget / tile[dd], size_t(1) );
+    counts[dd] = ( _localSubSizes[dd] + tile[dd] - 1 ) / tile[dd];
+  }
+
+  const int Ntiles = vector_helper::prod( counts );
+  tiles.resize( Ntiles );
+  for( int tt = 0; tt < Ntiles; ++tt ){
+    LocalRegion& r = tiles[tt];
+    r.start.resize( D );
+    r.size.resize( D );
+    for( int dd = D - 1, rem = tt; dd >= 0; --dd ){
+      int first = ( rem % counts[dd] ) * tile[dd];
+      rem /= counts[dd];
+      r.start[dd] = _localStarts[dd] + first;
+      r.size[dd] = std::min( tile[dd], _localSubSizes[dd] - first );
+    }
+  }
+  return tiles;
+}
  
 #endif //  DISTRIBUTED_DESCRIPTION_HPP
 
@@ -0,0 +1,134 @@
+/**
+ * @file HaloPlan.hpp
+ * @author Riccardo Zanella
+ * @date 10/2026
+ *
+ * Contacts: riccardo.zanella@gmail.com
+ *
+ */
+
+#ifndef HALO_PLAN_HPP
+#define HALO_PLAN_HPP
+
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+
+#include "mpi.h"
+#include "safecheck.hpp"
+
+// forward declare CartSplitter
+class CartSplitter;
+
+/**
+ * Persistent halo exchange on a fixed local buffer
+ *
+ * Created by CartSplitter::createHaloPlan(), holds persistent
+ * send/receive requests built once for a DistributedDescription
+ * and a local buffer: each exchange is then a start/wait pair,
+ * with no datatype or neighbour lookup and no allocation.
+ *
+ * The local buffer must not be reallocated (nor destroyed) while
+ * the plan is alive; the DistributedDescription must outlive the plan.
+ *
+ * Requests can be split in phases to be completed in sequence 
+ * (HaloMode::Sweep): start() completes all phases but last one.
+ */
+class HaloPlan {
+  private:
+    std::vector< MPI_Request > _requests; //!< persistent send/receive requests
+    std::vector< unsigned int > _phaseStarts; //!< first request of each phase (empty: one phase)
+    std::vector< MPI_Datatype > _types;   //!< datatypes owned by the plan
+    bool _active;                         //!< true between start() and wait()
+
+    // optional steps run before start and after completion ( e.g. packing )
+    void (*_preparation)( void * localData, const void * dd );
+    void (*_completion)( void * localData, const void * dd );
+    void * _localData;
+    const void * _dd;
+
+    // constructor is private, CartSplitter is a friend
+    friend class CartSplitter;
+
+    HaloPlan() : _requests(0), _phaseStarts(0), _types(0), _active(false),
+      _preparation(0), _completion(0), _localData(0), _dd(0) {}
+
+    unsigned int lastPhaseStart() const {
+      return _phaseStarts.empty() ? 0 : _phaseStarts.back();
+    }
+
+    HaloPlan ( const HaloPlan& );
+    HaloPlan& operator= ( const HaloPlan& );
+
+  public:
+    ~HaloPlan() {
+      try {
+        if ( _active )
+          wait();
+
+        for( unsigned int ii = 0; ii < _requests.size(); ++ii )
+          mpiSafeCall( MPI_Request_free( &_requests[ii] ) );
+
+        for( unsigned int ii = 0; ii < _types.size(); ++ii )
+          mpiSafeCall( MPI_Type_free( &_types[ii] ) );
+      } catch ( std::exception &e ){
+        std::cerr << "Errors on HaloPlan dtor: "
+          << e.what() << std::endl;
+      }
+    }
+
+    /**
+     * Starts halo exchange
+     *
+     * Same rules of CartSplitter::haloUpdateBegin apply to the
+     * local buffer until wait() returns.
+     */
+    void start() {
+      if ( _active )
+        throw std::runtime_error("HaloPlan::start() called on active plan");
+
+      if ( _preparation )
+        _preparation( _localData, _dd );
+
+      for( unsigned int ph = 0; ph + 1 < _phaseStarts.size(); ++ph ){
+        int count = _phaseStarts[ph+1] - _phaseStarts[ph];
+        if ( count ){
+          mpiSafeCall( MPI_Startall( count, &_requests[ _phaseStarts[ph] ] ) );
+          mpiSafeCall( MPI_Waitall( count, &_requests[ _phaseStarts[ph] ],
+                MPI_STATUSES_IGNORE ) );
+        }
+      }
+
+      int count = _requests.size() - lastPhaseStart();
+      if ( count )
+        mpiSafeCall( MPI_Startall( count, &_requests[ lastPhaseStart() ] ) );
+      _active = true;
+    }
+
+    /**
+     * Waits for completion of halo exchange started by start()
+     */
+    void wait() {
+      if ( !_active )
+        throw std::runtime_error("HaloPlan::wait() called on inactive plan");
+
+      int count = _requests.size() - lastPhaseStart();
+      if ( count )
+        mpiSafeCall( MPI_Waitall( count, &_requests[ lastPhaseStart() ],
+              MPI_STATUSES_IGNORE ) );
+      _active = false;
+
+      if ( _completion )
+        _completion( _localData, _dd );
+    }
+
+    /**
+     * Blocking halo exchange: start() followed by wait()
+     */
+    void update() {
+      start();
+      wait();
+    }
+};
+
+#endif // HALO_PLAN_HPP
@@ -0,0 +1,82 @@
+/**
+ * @file HaloRequest.hpp
+ * @author Riccardo Zanella
+ * @date 10/2026
+ *
+ * Contacts: riccardo.zanella@gmail.com
+ *
+ */
+
+#ifndef HALO_REQUEST_HPP
+#define HALO_REQUEST_HPP
+
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+
+#include "mpi.h"
+
+// forward declare CartSplitter
+class CartSplitter;
+
+/**
+ * Handle to a halo exchange in progress
+ *
+ * Obtained from CartSplitter::haloUpdateBegin(), must be completed
+ * by CartSplitter::haloUpdateEnd() before halos are read or
+ * the local buffer is modified.
+ *
+ * Requests can be moved but not copied, so that each exchange is
+ * completed once; destroying a pending request is reported on
+ * std::cerr ( its messages are left in flight ).
+ */
+class HaloRequest {
+  private:
+    std::vector< MPI_Request > _requests; //!< pending send/receive requests
+
+    // optional step run after completion ( e.g. unpacking )
+    void (*_completion)( void * localData, const void * dd );
+    void * _localData;
+    const void * _dd;
+
+    friend class CartSplitter;
+
+    HaloRequest ( const HaloRequest& );
+    HaloRequest& operator= ( const HaloRequest& );
+
+  public:
+    HaloRequest() : _requests(0), _completion(0), _localData(0), _dd(0) {}
+
+    HaloRequest( HaloRequest&& other ) : _requests(0), _completion( other._completion ),
+      _localData( other._localData ), _dd( other._dd ) {
+      _requests.swap( other._requests );
+      other._completion = 0;
+    }
+
+    HaloRequest& operator= ( HaloRequest&& other ){
+      if ( this != &other ){
+        if ( pending() )
+          throw std::runtime_error("HaloRequest: assignment to pending request");
+        _requests.swap( other._requests );
+        _completion = other._completion;
+        _localData = other._localData;
+        _dd = other._dd;
+        other._completion = 0;
+      }
+      return *this;
+    }
+
+    ~HaloRequest() {
+      if ( pending() )
+        std::cerr << "Errors on HaloRequest dtor: "
+          << "exchange not completed by haloUpdateEnd()" << std::endl;
+    }
+
+    /**
+     * Returns true if the exchange has not been completed yet
+     * @return true/false
+     */
+    bool pending() const { return !_requests.empty() || _completion; }
+};
+
+#endif // HALO_REQUEST_HPP
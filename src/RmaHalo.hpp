@@ -0,0 +1,130 @@
+/**
+ * @file RmaHalo.hpp
+ * @author Riccardo Zanella
+ * @date 10/2026
+ *
+ * Contacts: riccardo.zanella@gmail.com
+ *
+ */
+
+#ifndef RMA_HALO_HPP
+#define RMA_HALO_HPP
+
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+
+#include "mpi.h"
+#include "safecheck.hpp"
+
+// forward declare CartSplitter
+class CartSplitter;
+
+/**
+ * One sided halo exchange on a fixed local buffer
+ *
+ * Created by CartSplitter::createRmaHalo(): local buffer is exposed
+ * as an MPI window and each node puts its boundary regions straight
+ * into neighbour halos, with post-start-complete-wait synchronization
+ * restricted to first neighbours.
+ *
+ * The local buffer must not be reallocated (nor destroyed) while
+ * this object is alive; the DistributedDescription it was created
+ * from can be deleted first.
+ */
+class RmaHalo {
+  private:
+    /**
+     * Put of a local region into a neighbour halo
+     */
+    struct Put {
+      int target;                 //!< target rank
+      MPI_Datatype originType;    //!< region in local buffer ( owned )
+      MPI_Datatype targetType;    //!< region in target buffer ( owned )
+    };
+
+    MPI_Win _win;              //!< window over local buffer
+    void * _data;              //!< local buffer
+    MPI_Group _originGroup;    //!< nodes putting into local halos
+    MPI_Group _targetGroup;    //!< nodes whose halos are filled by current node
+    std::vector< Put > _puts;  //!< puts issued on each exchange
+    bool _active;              //!< true between start() and wait()
+
+    // constructor is private, CartSplitter is a friend
+    friend class CartSplitter;
+
+    RmaHalo() : _win( MPI_WIN_NULL ), _data(0), _originGroup( MPI_GROUP_NULL ),
+      _targetGroup( MPI_GROUP_NULL ), _puts(0), _active(false) {}
+
+    RmaHalo ( const RmaHalo& );
+    RmaHalo& operator= ( const RmaHalo& );
+
+  public:
+    ~RmaHalo() {
+      try {
+        if ( _active )
+          wait();
+
+        for( unsigned int ii = 0; ii < _puts.size(); ++ii ){
+          mpiSafeCall( MPI_Type_free( &_puts[ii].originType ) );
+          mpiSafeCall( MPI_Type_free( &_puts[ii].targetType ) );
+        }
+
+        // groups without neighbours are MPI_GROUP_EMPTY
+        if ( _targetGroup != MPI_GROUP_NULL && _targetGroup != MPI_GROUP_EMPTY )
+          mpiSafeCall( MPI_Group_free( &_targetGroup ) );
+        if ( _originGroup != MPI_GROUP_NULL && _originGroup != MPI_GROUP_EMPTY )
+          mpiSafeCall( MPI_Group_free( &_originGroup ) );
+        if ( _win != MPI_WIN_NULL )
+          mpiSafeCall( MPI_Win_free( &_win ) );
+      } catch ( std::exception &e ){
+        std::cerr << "Errors on RmaHalo dtor: "
+          << e.what() << std::endl;
+      }
+    }
+
+    /**
+     * Exposes local halos to neighbours and puts boundary regions
+     * into theirs
+     *
+     * Neither halos nor local buffer can be modified until wait()
+     * returns.
+     */
+    void start() {
+      if ( _active )
+        throw std::runtime_error("RmaHalo::start() called on active exchange");
+
+      mpiSafeCall( MPI_Win_post( _originGroup, 0, _win ) );
+      mpiSafeCall( MPI_Win_start( _targetGroup, 0, _win ) );
+
+      for( unsigned int ii = 0; ii < _puts.size(); ++ii )
+        mpiSafeCall( MPI_Put( _data, 1, _puts[ii].originType, _puts[ii].target,
+              0, 1, _puts[ii].targetType, _win ) );
+
+      _active = true;
+    }
+
+    /**
+     * Waits for completion of puts issued by current node and
+     * by neighbours
+     */
+    void wait() {
+      if ( !_active )
+        throw std::runtime_error("RmaHalo::wait() called on inactive exchange");
+
+      mpiSafeCall( MPI_Win_complete( _win ) );
+      mpiSafeCall( MPI_Win_wait( _win ) );
+
+      _active = false;
+    }
+
+    /**
+     * Blocking halo exchange: start() followed by wait()
+     */
+    void update() {
+      start();
+      wait();
+    }
+};
+
+#endif // RMA_HALO_HPP
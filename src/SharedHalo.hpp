@@ -0,0 +1,135 @@
+/**
+ * @file SharedHalo.hpp
+ * @author Riccardo Zanella
+ * @date 10/2026
+ *
+ * Contacts: riccardo.zanella@gmail.com
+ *
+ */
+
+#ifndef SHARED_HALO_HPP
+#define SHARED_HALO_HPP
+
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+
+#include "mpi.h"
+#include "safecheck.hpp"
+#include "pack_helper.hpp"
+
+// forward declare CartSplitter
+class CartSplitter;
+
+/**
+ * Local buffer allocated in a node shared memory window
+ *
+ * Created by CartSplitter::createSharedHalo(): local data live in
+ * an MPI-3 shared window, so that halos coming from neighbours on
+ * the same node are filled by direct loads from their memory.
+ * Halos from other nodes are exchanged with persistent point to
+ * point requests.
+ *
+ * update() must be called by all nodes in cart. The CartSplitter
+ * must outlive this object.
+ */
+template <typename T>
+class SharedHalo {
+  private:
+    /**
+     * Copy of a neighbour region ( in its buffer ) to a
+     * halo region ( in local buffer )
+     */
+    struct LocalCopy {
+      const T * src;              //!< first element of region in neighbour buffer
+      std::vector<int> srcDims;   //!< neighbour buffer dimensions
+      T * dst;                    //!< first element of region in local buffer
+      std::vector<int> dstDims;   //!< local buffer dimensions
+      std::vector<int> size;      //!< region size
+    };
+
+    MPI_Comm _nodeComm;   //!< communicator of nodes sharing memory ( not owned )
+    MPI_Win _win;         //!< shared window holding local buffers
+    T * _data;            //!< local buffer
+    size_t _size;         //!< number of values in local buffer
+
+    std::vector< LocalCopy > _copies;     //!< halos from same node neighbours
+    std::vector< MPI_Request > _requests; //!< halos from other nodes
+
+    // constructor is private, CartSplitter is a friend
+    friend class CartSplitter;
+
+    SharedHalo() : _nodeComm( MPI_COMM_NULL ), _win( MPI_WIN_NULL ),
+      _data(0), _size(0), _copies(0), _requests(0) {}
+
+    SharedHalo ( const SharedHalo& );
+    SharedHalo& operator= ( const SharedHalo& );
+
+  public:
+    ~SharedHalo() {
+      try {
+        for( unsigned int ii = 0; ii < _requests.size(); ++ii )
+          mpiSafeCall( MPI_Request_free( &_requests[ii] ) );
+
+        if ( _win != MPI_WIN_NULL ){
+          mpiSafeCall( MPI_Win_unlock_all( _win ) );
+          mpiSafeCall( MPI_Win_free( &_win ) );
+        }
+      } catch ( std::exception &e ){
+        std::cerr << "Errors on SharedHalo dtor: "
+          << e.what() << std::endl;
+      }
+    }
+
+    /**
+     * Returns local buffer ( same layout as described by
+     * DistributedDescription )
+     * @return pointer to first value
+     */
+    T * data() { return _data; }
+
+    /**
+     * Returns local buffer
+     * @return const pointer to first value
+     */
+    const T * data() const { return _data; }
+
+    /**
+     * Returns the number of values in local buffer
+     * @return see DistributedDescription::getLocalSize()
+     */
+    size_t size() const { return _size; }
+
+    /**
+     * Fills halos of local buffer
+     *
+     * Synchronizes with nodes on the same node before and after
+     * loading their data, so that buffers can be freely modified
+     * once update() returns.
+     */
+    void update() {
+      if ( !_requests.empty() )
+        mpiSafeCall( MPI_Startall( _requests.size(), &_requests[0] ) );
+
+      // local writes visible, neighbours done with their writes
+      mpiSafeCall( MPI_Win_sync( _win ) );
+      mpiSafeCall( MPI_Barrier( _nodeComm ) );
+      mpiSafeCall( MPI_Win_sync( _win ) );
+
+      for( unsigned int ii = 0; ii < _copies.size(); ++ii ){
+        const LocalCopy& c = _copies[ii];
+        pack_helper::copyRegion( c.src, &c.srcDims[0], c.dst, &c.dstDims[0],
+            &c.size[0], c.size.size() );
+      }
+
+      if ( !_requests.empty() )
+        mpiSafeCall( MPI_Waitall( _requests.size(), &_requests[0],
+              MPI_STATUSES_IGNORE ) );
+
+      // neighbours done with their loads
+      mpiSafeCall( MPI_Win_sync( _win ) );
+      mpiSafeCall( MPI_Barrier( _nodeComm ) );
+    }
+};
+
+#endif // SHARED_HALO_HPP
@@ -0,0 +1,219 @@
+/**
+ * @file ThreadPool.hpp
+ * @author Riccardo Zanella
+ * @date 10/2026
+ *
+ * Contacts: riccardo.zanella@gmail.com
+ *
+ */
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <stdexcept>
+
+/**
+ * Fixed set of threads running the same task
+ *
+ * run( task ) calls task( thread ) once on each thread, thread 0
+ * being the caller, and returns when all of them are done: threads
+ * sleep between runs. Exceptions thrown by a task are rethrown by
+ * run() ( first one only ).
+ *
+ * parallelFor( count, task ) calls task( index ) once for each index
+ * in [ 0, count ), with work stealing among threads.
+ *
+ * A pool is meant to be used by a single thread at a time.
+ */
+class ThreadPool {
+  private:
+    std::vector< std::thread > _workers;  //!< threads 1..size()-1
+    std::function< void(int) > _task;     //!< task of current run
+    std::exception_ptr _error;            //!< first exception of current run
+
+    std::mutex _mutex;
+    std::condition_variable _start;       //!< new run or shutdown
+    std::condition_variable _done;        //!< all workers finished
+    unsigned long _generation;            //!< number of runs started
+    int _running;                         //!< workers still in current run
+    bool _stop;                           //!< workers must exit
+
+    /**
+     * Indices still to be run by a thread: owner takes from front,
+     * thieves from back
+     */
+    struct Range {
+      std::mutex mutex;
+      int begin;
+      int end;
+    };
+
+    ThreadPool ( const ThreadPool& );
+    ThreadPool& operator= ( const ThreadPool& );
+
+    /**
+     * Takes next index of a thread, stealing half of the largest range
+     * of other threads when own range is empty
+     * @param ranges ranges of all threads
+     * @param thread current thread
+     * @param index next index ( filled )
+     * @return false if no index is left
+     */
+    bool next( Range * ranges, int thread, int& index ){
+      const int P = size();
+      for(;;){
+        {
+          std::lock_guard< std::mutex > lock( ranges[thread].mutex );
+          if ( ranges[thread].begin < ranges[thread].end ){
+            index = ranges[thread].begin++;
+            return true;
+          }
+        }
+
+        int victim = -1, left = 0;
+        for( int tt = 1; tt < P; ++tt ){
+          Range& r = ranges[ ( thread + tt ) % P ];
+          std::lock_guard< std::mutex > lock( r.mutex );
+          if ( r.end - r.begin > left ){
+            left = r.end - r.begin;
+            victim = ( thread + tt ) % P;
+          }
+        }
+        if ( victim < 0 )
+          return false;
+
+        int begin, end;
+        {
+          Range& r = ranges[victim];
+          std::lock_guard< std::mutex > lock( r.mutex );
+          if ( r.end - r.begin < 1 )
+            continue; // emptied meanwhile
+          end = r.end;
+          begin = r.end - ( r.end - r.begin + 1 ) / 2;
+          r.end = begin;
+        }
+        std::lock_guard< std::mutex > lock( ranges[thread].mutex );
+        ranges[thread].begin = begin;
+        ranges[thread].end = end;
+      }
+    }
+
+    void work( int thread ){
+      unsigned long seen = 0;
+      for(;;){
+        {
+          std::unique_lock< std::mutex > lock( _mutex );
+          _start.wait( lock, [&]{ return _stop || _generation != seen; } );
+          if ( _stop )
+            return;
+          seen = _generation;
+        }
+
+        execute( thread );
+
+        std::lock_guard< std::mutex > lock( _mutex );
+        if ( --_running == 0 )
+          _done.notify_one();
+      }
+    }
+
+    void execute( int thread ){
+      try {
+        _task( thread );
+      } catch ( ... ){
+        std::lock_guard< std::mutex > lock( _mutex );
+        if ( !_error )
+          _error = std::current_exception();
+      }
+    }
+
+  public:
+    /**
+     * Creates a pool
+     * @param threads number of threads, caller included ( at least 1 )
+     */
+    explicit ThreadPool( int threads )
+      : _workers(0), _generation(0), _running(0), _stop(false) {
+      if ( threads < 1 )
+        throw std::runtime_error("ThreadPool: at least one thread needed");
+      for( int tt = 1; tt < threads; ++tt )
+        _workers.push_back( std::thread( &ThreadPool::work, this, tt ) );
+    }
+
+    ~ThreadPool() {
+      {
+        std::lock_guard< std::mutex > lock( _mutex );
+        _stop = true;
+      }
+      _start.notify_all();
+      for( unsigned int tt = 0; tt < _workers.size(); ++tt )
+        _workers[tt].join();
+    }
+
+    /**
+     * Returns the number of threads, caller included
+     * @return number of threads
+     */
+    int size() const { return _workers.size() + 1; }
+
+    /**
+     * Runs task( thread ) on each thread, thread in [ 0, size() )
+     * @param task callable taking thread index
+     */
+    template <typename Task>
+      void run( Task task ){
+        {
+          std::lock_guard< std::mutex > lock( _mutex );
+          _task = task;
+          _error = std::exception_ptr();
+          _running = _workers.size();
+          ++_generation;
+        }
+        _start.notify_all();
+
+        execute( 0 );
+
+        std::exception_ptr error;
+        {
+          std::unique_lock< std::mutex > lock( _mutex );
+          _done.wait( lock, [&]{ return _running == 0; } );
+          error = _error;
+          _task = std::function< void(int) >();
+        }
+        if ( error )
+          std::rethrow_exception( error );
+      }
+
+    /**
+     * Runs task( index ) for each index in [ 0, count )
+     * @param count number of indices
+     * @param task callable taking index
+     *
+     * Each thread starts from an even share of consecutive indices,
+     * in order; idle threads steal the second half of the largest 
+     * share left.
+     */
+    template <typename Task>
+      void parallelFor( int count, Task task ){
+        const int P = size();
+        std::vector< Range > ranges( P );
+        for( int tt = 0; tt < P; ++tt ){
+          ranges[tt].begin = (long) count * tt / P;
+          ranges[tt].end = (long) count * ( tt + 1 ) / P;
+        }
+
+        run( [&]( int thread ){
+            int index;
+            while ( next( &ranges[0], thread, index ) )
+              task( index );
+            } );
+      }
+};
+
+#endif // THREAD_POOL_HPP
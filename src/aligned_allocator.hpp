@@ -0,0 +1,62 @@
+/**
+ * @file aligned_allocator.hpp
+ * @author Riccardo Zanella
+ * @date 10/2026
+ *
+ * Contacts: riccardo.zanella@gmail.com
+ *
+ */
+
+#ifndef ALIGNED_ALLOCATOR_HPP
+#define ALIGNED_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/**
+ * Standard allocator returning storage aligned to Alignment bytes
+ * ( a cache line by default )
+ *
+ * Alignment must be a power of two multiple of sizeof(void*).
+ */
+template <typename T, std::size_t Alignment = 64>
+class aligned_allocator {
+  public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template <typename U>
+      struct rebind { typedef aligned_allocator<U, Alignment> other; };
+
+    aligned_allocator() {}
+
+    template <typename U>
+      aligned_allocator( const aligned_allocator<U, Alignment>& ) {}
+
+    T* allocate( size_type n ){
+      if ( n == 0 )
+        return 0;
+      void * p = 0;
+      if ( posix_memalign( &p, Alignment, n * sizeof(T) ) != 0 )
+        throw std::bad_alloc();
+      return static_cast<T*>( p );
+    }
+
+    void deallocate( T* p, size_type ){
+      std::free( p );
+    }
+};
+
+template <typename T, typename U, std::size_t Alignment>
+bool operator== ( const aligned_allocator<T, Alignment>&,
+    const aligned_allocator<U, Alignment>& ){ return true; }
+
+template <typename T, typename U, std::size_t Alignment>
+bool operator!= ( const aligned_allocator<T, Alignment>&,
+    const aligned_allocator<U, Alignment>& ){ return false; }
+
+#endif // ALIGNED_ALLOCATOR_HPP
@@ -0,0 +1,139 @@
+/**
+ * @file pack_helper.hpp
+ * @author Riccardo Zanella
+ * @date 10/2026
+ *
+ * Contacts: riccardo.zanella@gmail.com
+ *
+ */
+
+#ifndef PACK_HELPER
+#define PACK_HELPER
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+/**
+  * Contains copy loops between N-d regions and contiguous buffers.
+  */
+namespace pack_helper {
+
+  /**
+   * Copy loops with the number of dimensions known at compile time:
+   * strides are computed with constant trip count loops and the
+   * recursion on dimensions is unrolled by the compiler
+   */
+  template <int D>
+    struct FixedRegion {
+      template <typename T>
+        static void copy( const T* src, const int* srcDims,
+            T* dst, const int* dstDims, const int* size ){
+          std::ptrdiff_t srcStride = 1, dstStride = 1;
+          for( int dd = 1; dd < D; ++dd ){
+            srcStride *= srcDims[dd];
+            dstStride *= dstDims[dd];
+          }
+          for( int ii = 0; ii < size[0]; ++ii, src += srcStride, dst += dstStride )
+            FixedRegion< D - 1 >::copy( src, srcDims + 1, dst, dstDims + 1, size + 1 );
+        }
+    };
+
+  template <>
+    struct FixedRegion<1> {
+      template <typename T>
+        static void copy( const T* src, const int*, T* dst, const int*,
+            const int* size ){
+          std::copy( src, src + size[0], dst );
+        }
+    };
+
+  /**
+   * Copies a region between two N-d arrays (C order)
+   * @param src pointer to first element of region in source array
+   * @param srcDims source array dimensions
+   * @param dst pointer to first element of region in destination array
+   * @param dstDims destination array dimensions
+   * @param size region size for each dimension
+   * @param D number of dimensions
+   *
+   * Last dimension is copied with a contiguous std::copy, so that
+   * the compiler can vectorize it; up to 4 dimensions the copy is
+   * dispatched to FixedRegion<D>.
+   */
+  template <typename T>
+    void copyRegion( const T* src, const int* srcDims,
+        T* dst, const int* dstDims, const int* size, int D ){
+
+      switch ( D ){
+        case 1: FixedRegion<1>::copy( src, srcDims, dst, dstDims, size ); return;
+        case 2: FixedRegion<2>::copy( src, srcDims, dst, dstDims, size ); return;
+        case 3: FixedRegion<3>::copy( src, srcDims, dst, dstDims, size ); return;
+        case 4: FixedRegion<4>::copy( src, srcDims, dst, dstDims, size ); return;
+      }
+
+      // distance between consecutive elements on first dimension
+      std::ptrdiff_t srcStride = 1, dstStride = 1;
+      for( int dd = 1; dd < D; ++dd ){
+        srcStride *= srcDims[dd];
+        dstStride *= dstDims[dd];
+      }
+
+      for( int ii = 0; ii < size[0]; ++ii, src += srcStride, dst += dstStride )
+        copyRegion( src, srcDims + 1, dst, dstDims + 1, size + 1, D - 1 );
+    }
+
+  /**
+   * Returns the linear offset of coords in an N-d array (C order)
+   * @param dims array dimensions
+   * @param coords coordinates
+   * @return offset
+   */
+  inline std::ptrdiff_t offset( const std::vector<int>& dims,
+      const std::vector<int>& coords ){
+      std::ptrdiff_t off = 0;
+      for( unsigned int dd = 0; dd < dims.size(); ++dd )
+        off = off * dims[dd] + coords[dd];
+      return off;
+    }
+
+  /**
+   * Copies a region of an N-d array to a contiguous buffer
+   * @param data N-d array
+   * @param dims array dimensions
+   * @param start first element of region
+   * @param size region size
+   * @param buffer destination (prod(size) elements)
+   */
+  template <typename T>
+    void pack( const T* data, const std::vector<int>& dims,
+        const std::vector<int>& start, const std::vector<int>& size,
+        T* buffer ){
+      for( unsigned int dd = 0; dd < size.size(); ++dd )
+        if ( size[dd] == 0 )
+          return;
+      copyRegion( data + offset( dims, start ), &dims[0],
+          buffer, &size[0], &size[0], dims.size() );
+    }
+
+  /**
+   * Copies a contiguous buffer to a region of an N-d array
+   * @param buffer source (prod(size) elements)
+   * @param data N-d array
+   * @param dims array dimensions
+   * @param start first element of region
+   * @param size region size
+   */
+  template <typename T>
+    void unpack( const T* buffer, T* data, const std::vector<int>& dims,
+        const std::vector<int>& start, const std::vector<int>& size ){
+      for( unsigned int dd = 0; dd < size.size(); ++dd )
+        if ( size[dd] == 0 )
+          return;
+      copyRegion( buffer, &size[0], data + offset( dims, start ),
+          &dims[0], &size[0], dims.size() );
+    }
+
+} // end of namespace pack_helper
+
+#endif // PACK_HELPER
@@ -44,7 +44,13 @@ static const std::map < std::string, HaloType::type,  case_insensitive_less > ha
     {"TIGHT", HaloType::Tight} 
   };
 
+static const std::map < std::string, CollectiveMode::type,  case_insensitive_less > collective_set = { 
+    {"FLAT", CollectiveMode::Flat}, 
+    {"HIERARCHICAL", CollectiveMode::Hierarchical} 
+  };
+
 int main (int argc, char *argv[]){
+  int totalErrors = 0;
   try{
     mpiSafeCall( MPI_Init(&argc, &argv) );
     int worldRank, worldSize;
@@ -52,31 +58,43 @@ int main (int argc, char *argv[]){
     mpiSafeCall( MPI_Comm_size ( MPI_COMM_WORLD, &worldSize ) );
    
     HaloType::type haloType = HaloType::Unused; 
+    CollectiveMode::type collectiveMode = CollectiveMode::Flat; 
     vector<int> tileSplit = { 3, 3 };
     vector<int> periodicity = { 0, 0 };
     vector<int> dims = { 1200, 1200 }; 
     int dh = 20; // default halo size
 
+    // arguments checked by first node, all nodes leave on errors
+    int validArgs = 1;
     if ( worldRank == 0) {
-      switch ( argc ){
-        case 2:
-          try {
-          haloType = valueFromKey( 
-              std::string( argv[1]), halo_set );
-          }
-          catch ( exception& e ){
-               std::stringstream ss;
-               ss << e.what() << endl
-                 << "halo type must be one of: "
-                 << make_pretty(halo_set).tuple_separator(" | ").preamble("[ ")
-                 .epilogue(" ]");
-               throw runtime_error( ss.str() ); 
-          }
+      try {
+        if ( argc > 3 )
+          throw runtime_error("too many arguments");
+        if ( argc > 1 )
+          haloType = valueFromKey( std::string( argv[1] ), halo_set );
+        if ( argc > 2 )
+          collectiveMode = valueFromKey( std::string( argv[2] ), collective_set );
       }
+      catch ( exception& e ){
+        validArgs = 0;
+        cerr << "Error: " << e.what() << endl
+          << "usage: 2d_halo_scatter_test "
+          << make_pretty(halo_set).tuple_separator(" | ").preamble("[ ")
+          .epilogue(" ]") << " "
+          << make_pretty(collective_set).tuple_separator(" | ").preamble("[ ")
+          .epilogue(" ]") << endl;
+      }
+    }
+
+    mpiSafeCall( MPI_Bcast( &validArgs, 1, MPI_INT, 0, MPI_COMM_WORLD ) );
+    if ( !validArgs ){
+      mpiSafeCall( MPI_Finalize() );
+      return (EXIT_FAILURE);
     }
 
     // Broadcast of test parameters
     MPI_Bcast( &haloType, 1, MPI_INT, 0, MPI_COMM_WORLD );
+    MPI_Bcast( &collectiveMode, 1, MPI_INT, 0, MPI_COMM_WORLD );
 
     vector<double> data; 
     CartSplitter cs( tileSplit, periodicity, MPI_COMM_WORLD );
@@ -114,7 +132,7 @@ int main (int argc, char *argv[]){
       const vector< int >& localDims = dd->getLocalDims(); 
 
       // data distribution
-      cs.scatter( data, localData, ROOT, dd );
+      cs.scatter( data, localData, ROOT, dd, collectiveMode );
       
       // halo update from neighbours
       cs.haloUpdate( localData, dd );
@@ -135,7 +153,13 @@ int main (int argc, char *argv[]){
       }
       
       // gathering internal portions
-      cs.gather( localData, dataBack, COLLECTROOT, dd );
+      cs.gather( localData, dataBack, COLLECTROOT, dd, collectiveMode );
+
+      // repeated calls reuse the node shared buffer
+      std::fill( localData.begin(), localData.end(), 0. );
+      std::fill( dataBack.begin(), dataBack.end(), 0. );
+      cs.scatter( data, localData, ROOT, dd, collectiveMode );
+      cs.gather( localData, dataBack, COLLECTROOT, dd, collectiveMode );
 
       // data print
       if ( COLLECTROOT == cartRank ) {
@@ -160,12 +184,12 @@ int main (int argc, char *argv[]){
      
       // ROOT checks for errors 
       if ( cartRank == ROOT ){
-          int ee = 0; 
           for( unsigned int ii = 0; ii <  data.size() ; ++ii )
-            ee += ( std::abs( dataBack[ii] - data[ii] ) / std::abs( data[ii] ) > 1e-12 );
+            totalErrors += ( std::abs( dataBack[ii] - data[ii] ) / std::abs( data[ii] ) > 1e-12 );
 
-          cout << "Errors: " << ee << endl;
+          cout << "Errors: " << totalErrors << endl;
       }
+      mpiSafeCall( MPI_Bcast( &totalErrors, 1, MPI_INT, ROOT, comm ) );
 
       delete dd;
     }
@@ -186,6 +210,6 @@ int main (int argc, char *argv[]){
 
   mpiSafeCall( MPI_Barrier( MPI_COMM_WORLD ) );
   mpiSafeCall( MPI_Finalize() );
-  return (EXIT_SUCCESS);
+  return ( totalErrors ? EXIT_FAILURE : EXIT_SUCCESS );
 }
 
@@ -0,0 +1,92 @@
+/**
+ * @file aligned_buffer.cpp
+ * @author Riccardo Zanella
+ * @date 10/2026
+ *
+ * Contacts: riccardo.zanella@gmail.com
+ *
+ */
+
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+
+#include "mpi.h"
+
+#include "safecheck.hpp"
+#include "vector_helper.hpp"
+#include "CartSplitter.hpp"
+#include "check_helpers.hpp"
+
+using std::exception;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::vector;
+
+using namespace vector_helper;
+
+// aligned local buffers on a 3x3 grid ( np >= 9 ): rows padded to
+// 8 doubles, scatter / halo update / gather through pointer overloads
+
+int main (int argc, char *argv[]){
+  int totalErrors = 0;
+  try{
+    mpiSafeCall( MPI_Init(&argc, &argv) );
+
+    vector<int> tileSplit = { 3, 3 };
+    vector<int> periodicity = { 0, 0 };
+    vector<int> dims = { 200, 151 };
+    int dh = 2;
+
+    CartSplitter cs( tileSplit, periodicity, MPI_COMM_WORLD );
+
+    if ( cs.inGrid() ){
+      const int ROOT = 0;
+      const int cartRank = cs.getRank();
+
+      DistributedDescription<double> * padded =
+        cs.createDistributedDescription<double>( dims, dh, dh, HaloType::Full,
+            HaloMode::Direct, StencilShape::Box, 1, 8 );
+
+      vector<double> data, dataBack;
+      if ( ROOT == cartRank ){
+        data = rowColumnData( dims );
+        dataBack = vector<double>( prod( dims ) );
+      }
+
+      DistributedDescription<double>::Buffer alignedData = padded->createLocalBuffer();
+      cs.scatter( data.data(), data.size(), alignedData.data(), alignedData.size(),
+          ROOT, padded );
+      cs.haloUpdate( alignedData.data(), alignedData.size(), padded );
+      cs.gather( alignedData.data(), alignedData.size(), dataBack.data(),
+          dataBack.size(), ROOT, padded );
+
+      // first value and row pitch on 64 byte boundaries
+      int errors =
+        ( reinterpret_cast<std::uintptr_t>( alignedData.data() ) % 64 != 0 )
+        + ( padded->getLocalDims()[1] * sizeof(double) % 64 != 0 );
+      if ( ROOT == cartRank )
+        errors += countMismatches( data, dataBack );
+
+      mpiSafeCall( MPI_Allreduce( &errors, &totalErrors, 1, MPI_INT, MPI_SUM,
+            cs.getCommunicator() ) );
+      if ( ROOT == cartRank )
+        cout << "Errors: " << totalErrors << endl;
+
+      delete padded;
+    }
+
+    MPI_Barrier( MPI_COMM_WORLD );
+  }
+  catch ( exception &e){
+    cerr << "Error: " << e.what() << endl;
+    return (EXIT_FAILURE);
+  }
+
+  mpiSafeCall( MPI_Barrier( MPI_COMM_WORLD ) );
+  mpiSafeCall( MPI_Finalize() );
+  return ( totalErrors ? EXIT_FAILURE : EXIT_SUCCESS );
+}
@@ -0,0 +1,43 @@
+/**
+ * @file check_helpers.hpp
+ * @author Riccardo Zanella
+ * @date 10/2026
+ *
+ * Contacts: riccardo.zanella@gmail.com
+ *
+ */
+
+#ifndef CHECK_HELPERS_HPP
+#define CHECK_HELPERS_HPP
+
+#include <vector>
+#include <cmath>
+
+/**
+ * Fills a 2-d array with 100*(row+1) + column
+ * @param dims array dimensions
+ * @return filled array ( C order )
+ */
+inline std::vector<double> rowColumnData( const std::vector<int>& dims ){
+  std::vector<double> data( dims[0] * dims[1] );
+  for( int r = 0; r < dims[0]; ++r )
+    for( int c = 0; c < dims[1]; ++c )
+      data[ r*dims[1] + c ] = 100*(r+1) + c;
+  return data;
+}
+
+/**
+ * Counts elements of actual differing from expected ( relative
+ * tolerance 1e-12 ), missing elements included
+ */
+template <typename T>
+int countMismatches( const std::vector<T>& expected,
+    const std::vector<T>& actual ){
+  int errors = 0;
+  for( unsigned int ii = 0; ii < expected.size(); ++ii )
+    errors += ii >= actual.size()
+      || std::abs( actual[ii] - expected[ii] ) > 1e-12 * std::abs( expected[ii] );
+  return errors;
+}
+
+#endif // CHECK_HELPERS_HPP
@@ -0,0 +1,111 @@
+/**
+ * @file distributed_io.cpp
+ * @author Riccardo Zanella
+ * @date 10/2026
+ *
+ * Contacts: riccardo.zanella@gmail.com
+ *
+ */
+
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "mpi.h"
+
+#include "safecheck.hpp"
+#include "vector_helper.hpp"
+#include "CartSplitter.hpp"
+#include "check_helpers.hpp"
+
+using std::exception;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::vector;
+using std::string;
+
+using namespace vector_helper;
+
+// MPI-IO round trip of internal portions on a 3x3 grid ( np >= 9 ):
+// file written by all nodes must hold overall data in C order,
+// after a header when a displacement is given
+
+int main (int argc, char *argv[]){
+  int totalErrors = 0;
+  try{
+    mpiSafeCall( MPI_Init(&argc, &argv) );
+
+    vector<int> tileSplit = { 3, 3 };
+    vector<int> periodicity = { 0, 0 };
+    vector<int> dims = { 200, 150 };
+    int dh = 2;
+
+    CartSplitter cs( tileSplit, periodicity, MPI_COMM_WORLD );
+
+    if ( cs.inGrid() ){
+      const int ROOT = 0;
+      const int cartRank = cs.getRank();
+
+      DistributedDescription<double> * dd =
+        cs.createDistributedDescription<double>( dims, dh, dh, HaloType::Full );
+
+      vector<double> data, dataBack;
+      if ( ROOT == cartRank ){
+        data = rowColumnData( dims );
+        dataBack = vector<double>( prod( dims ) );
+      }
+
+      vector<double> localData( dd->getLocalSize( ) );
+      cs.scatter( data, localData, ROOT, dd );
+
+      const string filename( "distributed_io.raw" );
+      const MPI_Offset header[] = { 0, 64 };
+      int errors = 0;
+      for( int hh = 0; hh < 2; ++hh ){
+        cs.writeDistributed( filename, localData, dd, header[hh] );
+        vector<double> fileData( dd->getLocalSize( ) );
+        cs.readDistributed( filename, fileData, dd, header[hh] );
+        cs.gather( fileData, dataBack, ROOT, dd );
+
+        if ( ROOT == cartRank ){
+          errors += countMismatches( data, dataBack );
+
+          // file content, read back by root alone
+          vector<double> file( prod( dims ) );
+          FILE * f = std::fopen( filename.c_str(), "rb" );
+          errors += ( f == 0 );
+          if ( f ){
+            std::fseek( f, header[hh], SEEK_SET );
+            errors += std::fread( &file[0], sizeof(double), file.size(), f )
+              != file.size();
+            std::fclose( f );
+          }
+          errors += countMismatches( data, file );
+          std::remove( filename.c_str() );
+        }
+        cs.barrier();
+      }
+
+      mpiSafeCall( MPI_Allreduce( &errors, &totalErrors, 1, MPI_INT, MPI_SUM,
+            cs.getCommunicator() ) );
+      if ( ROOT == cartRank )
+        cout << "Errors: " << totalErrors << endl;
+
+      delete dd;
+    }
+
+    MPI_Barrier( MPI_COMM_WORLD );
+  }
+  catch ( exception &e){
+    cerr << "Error: " << e.what() << endl;
+    return (EXIT_FAILURE);
+  }
+
+  mpiSafeCall( MPI_Barrier( MPI_COMM_WORLD ) );
+  mpiSafeCall( MPI_Finalize() );
+  return ( totalErrors ? EXIT_FAILURE : EXIT_SUCCESS );
+}
@@ -0,0 +1,70 @@
+/**
+ * @file grid_shape.cpp
+ * @author Riccardo Zanella
+ * @date 10/2026
+ *
+ * Contacts: riccardo.zanella@gmail.com
+ *
+ */
+
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include "mpi.h"
+
+#include "safecheck.hpp"
+#include "vector_helper.hpp"
+#include "CartSplitter.hpp"
+
+using std::exception;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::vector;
+
+using namespace vector_helper;
+
+// grid shape minimizing halo volume ( any np ): square data on a
+// square grid, slabs on elongated grids, all nodes in grid
+
+int main (int argc, char *argv[]){
+  int totalErrors = 0;
+  try{
+    mpiSafeCall( MPI_Init(&argc, &argv) );
+    int worldRank;
+    mpiSafeCall( MPI_Comm_rank ( MPI_COMM_WORLD, &worldRank ) );
+
+    vector<int> dims = { 1200, 1200 };
+    vector<int> slab = { 1200, 300 };
+    vector<int> halo( 2, 20 );
+
+    CartSplitter * fitted = CartSplitter::createForData( dims, vector<int>( 2, 0 ),
+        halo, halo, MPI_COMM_WORLD );
+    int errors = !fitted->inGrid();
+    delete fitted;
+
+    if ( worldRank == 0 ){
+      errors += ( CartSplitter::bestGridDims( 9, dims, halo, halo )
+          != vector<int>( { 3, 3 } ) );
+      errors += ( CartSplitter::bestGridDims( 12, slab, halo, halo )
+          != vector<int>( { 6, 2 } ) );
+      errors += ( CartSplitter::bestGridDims( 7, dims, halo, halo )
+          != vector<int>( { 7, 1 } ) );
+    }
+
+    mpiSafeCall( MPI_Allreduce( &errors, &totalErrors, 1, MPI_INT, MPI_SUM,
+          MPI_COMM_WORLD ) );
+    if ( worldRank == 0 )
+      cout << "Errors: " << totalErrors << endl;
+  }
+  catch ( exception &e){
+    cerr << "Error: " << e.what() << endl;
+    return (EXIT_FAILURE);
+  }
+
+  mpiSafeCall( MPI_Barrier( MPI_COMM_WORLD ) );
+  mpiSafeCall( MPI_Finalize() );
+  return ( totalErrors ? EXIT_FAILURE : EXIT_SUCCESS );
+}
@@ -0,0 +1,494 @@
+/**
+ * @file halo_check.cpp
+ * @author Riccardo Zanella
+ * @date 10/2026
+ *
+ * Contacts: riccardo.zanella@gmail.com
+ *
+ */
+
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <string>
+
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+#include "mpi.h"
+
+#include "safecheck.hpp"
+#include "vector_helper.hpp"
+#include "CartSplitter.hpp"
+#include "test_helpers.hpp"
+
+using std::exception;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::vector;
+using std::string;
+using std::runtime_error;
+
+using namespace vector_helper;
+
+// halo exchange flavours under test
+struct HaloVariant {
+  enum type { Blocking=0, Split=1, Plan=2, Fields=3, Shared=4, Rma=5, Overlap=6, 
+    Tiles=7, Errors=8 };
+};
+
+static const std::map < std::string, HaloVariant::type, case_insensitive_less > variant_set = {
+    {"BLOCKING", HaloVariant::Blocking},
+    {"SPLIT", HaloVariant::Split},
+    {"PLAN", HaloVariant::Plan},
+    {"FIELDS", HaloVariant::Fields},
+    {"SHARED", HaloVariant::Shared},
+    {"RMA", HaloVariant::Rma},
+    {"OVERLAP", HaloVariant::Overlap},
+    {"TILES", HaloVariant::Tiles},
+    {"ERRORS", HaloVariant::Errors}
+  };
+
+static const std::map < std::string, HaloEngine::type, case_insensitive_less > engine_set = {
+    {"P2P", HaloEngine::PointToPoint},
+    {"NEIGHBORHOOD", HaloEngine::Neighborhood},
+    {"PACKED", HaloEngine::Packed},
+    {"AGGREGATED", HaloEngine::Aggregated},
+    {"THREADED", HaloEngine::Threaded}
+  };
+
+static const std::map < std::string, HaloMode::type, case_insensitive_less > mode_set = {
+    {"DIRECT", HaloMode::Direct},
+    {"SWEEP", HaloMode::Sweep}
+  };
+
+static const std::map < std::string, StencilShape::type, case_insensitive_less > stencil_set = {
+    {"BOX", StencilShape::Box},
+    {"STAR", StencilShape::Star}
+  };
+
+static const std::map < std::string, HaloType::type, case_insensitive_less > halo_set = {
+    {"FULL", HaloType::Full},
+    {"TIGHT", HaloType::Tight}
+  };
+
+/**
+ * Counts halo elements of localData not matching global data
+ *
+ * Global data is the linear index of each element, plus one, 
+ * multiplied by scale; component c of each element adds c/4.
+ * Halo elements falling outside non periodic boundaries are skipped,
+ * as well as edges and corners for star stencils and row padding.
+ */
+static int checkHalos( const vector<double>& localData,
+    const vector<int>& dims, const vector<int>& periodicity,
+    const vector<int>& globalStarts, StencilShape::type stencil,
+    const DistributedDescription<double>* dd, double scale = 1.0 ){
+
+  const vector<int>& localDims = dd->getLocalDims();
+  const vector<int>& localExtents = dd->getLocalExtents();
+  const vector<int>& localStarts = dd->getLocalStarts();
+  const vector<int>& localSubsizes = dd->getLocalSubsizes();
+  const int D = localDims.size();
+  const int C = dd->getComponents();
+
+  int errors = 0;
+  vector<int> idx( D, 0 );
+  for( size_t ii = 0; ii < localData.size(); ii += C ){
+
+    int outside = 0;
+    bool valid = true;
+    long expected = 0;
+    for( int dd = 0; dd < D; ++dd ){
+      outside += idx[dd] < localStarts[dd]
+        || idx[dd] >= localStarts[dd] + localSubsizes[dd];
+      int g = globalStarts[dd] + idx[dd] - localStarts[dd];
+      if ( g < 0 || g >= dims[dd] ){
+        if ( periodicity[dd] )
+          g = ( g + dims[dd] ) % dims[dd];
+        else
+          valid = false;
+      }
+      expected = expected * dims[dd] + g;
+      if ( idx[dd] >= localExtents[dd] )
+        valid = false;
+    }
+
+    if ( stencil == StencilShape::Star && outside > 1 )
+      valid = false;
+
+    for( int cc = 0; outside && valid && cc < C; ++cc )
+      errors += ( localData[ii+cc] != scale * double( expected + 1 ) + 0.25 * cc );
+
+    // next local index, last dimension is contiguous
+    for( int dd = D-1; dd >= 0; --dd ){
+      if ( ++idx[dd] < localDims[dd] )
+        break;
+      idx[dd] = 0;
+    }
+  }
+
+  return errors;
+}
+
+/**
+ * Calls visit( index ) on the linear index of each element of a region
+ */
+template <typename Visit>
+static void visitRegion( const LocalRegion& r, const vector<int>& localDims,
+    Visit visit ){
+  for( int ii = 0; ii < prod( r.size ); ++ii ){
+    // linear index of ii-th element of region
+    int rem = ii, lin = 0;
+    for( int d = localDims.size() - 1, stride = 1; d >= 0; --d ){
+      lin += ( r.start[d] + rem % r.size[d] ) * stride;
+      rem /= r.size[d];
+      stride *= localDims[d];
+    }
+    visit( lin );
+  }
+}
+
+/**
+ * Counts local elements not visited once if internal, or visited if not
+ */
+template <typename Count>
+static int checkVisits( const vector<Count>& visits, 
+    const DistributedDescription<double>* dd ){
+  const vector<int>& localDims = dd->getLocalDims();
+  const vector<int>& localStarts = dd->getLocalStarts();
+  const vector<int>& localSubsizes = dd->getLocalSubsizes();
+  int errors = 0;
+  for( unsigned int ii = 0; ii < visits.size(); ++ii ){
+    bool internal = true;
+    for( int d = localDims.size() - 1, rem = ii; d >= 0; --d ){
+      int idx = rem % localDims[d];
+      rem /= localDims[d];
+      internal = internal && idx >= localStarts[d] 
+        && idx < localStarts[d] + localSubsizes[d];
+    }
+    errors += visits[ii] != ( internal ? 1 : 0 );
+  }
+  return errors;
+}
+
+/**
+ * Returns 1 if call() does not throw std::exception, 0 otherwise
+ */
+template <typename Call>
+static int missingThrow( Call call ){
+  try {
+    call();
+  } catch ( exception& ){
+    return 0;
+  }
+  return 1;
+}
+
+int main (int argc, char *argv[]){
+  int totalErrors = 0;
+  try{
+    // threaded engine posts messages from several threads when allowed
+    int provided;
+    mpiSafeCall( MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided) );
+    int worldRank;
+    mpiSafeCall( MPI_Comm_rank ( MPI_COMM_WORLD, &worldRank ) );
+
+    HaloVariant::type variant = HaloVariant::Blocking;
+    HaloType::type haloType = HaloType::Full;
+    HaloEngine::type engine = HaloEngine::PointToPoint;
+    HaloMode::type haloMode = HaloMode::Direct;
+    StencilShape::type stencil = StencilShape::Box;
+    vector<int> tileSplit = { 2, 2, 2 };
+    vector<int> periodicity = { 1, 0, 1 };
+    vector<int> dims = { 30, 25, 20 };
+    int haloPre = 2, haloPost = 1;
+    int components = 1;
+    int rowAlign = 1;
+
+    // arguments checked by first node, all nodes leave on errors
+    int validArgs = 1;
+    if ( worldRank == 0) {
+      try {
+        if ( argc > 8 )
+          throw runtime_error("too many arguments");
+        if ( argc > 1 )
+          variant = valueFromKey( std::string( argv[1] ), variant_set );
+        if ( argc > 2 )
+          haloType = valueFromKey( std::string( argv[2] ), halo_set );
+        if ( argc > 3 )
+          engine = valueFromKey( std::string( argv[3] ), engine_set );
+        if ( argc > 4 )
+          haloMode = valueFromKey( std::string( argv[4] ), mode_set );
+        if ( argc > 5 )
+          stencil = valueFromKey( std::string( argv[5] ), stencil_set );
+        if ( argc > 6 && !( std::istringstream( argv[6] ) >> components 
+              && components > 0 ) )
+          throw runtime_error("components must be a positive integer");
+        if ( argc > 7 && !( std::istringstream( argv[7] ) >> rowAlign
+              && rowAlign > 0 ) )
+          throw runtime_error("rowAlign must be a positive integer");
+      }
+      catch ( exception& e ){
+        validArgs = 0;
+        cerr << "Error: " << e.what() << endl
+          << "usage: halo_check_test "
+          << make_pretty(variant_set).tuple_separator(" | ").preamble("[ ")
+          .epilogue(" ]") << " "
+          << make_pretty(halo_set).tuple_separator(" | ").preamble("[ ")
+          .epilogue(" ]") << " "
+          << make_pretty(engine_set).tuple_separator(" | ").preamble("[ ")
+          .epilogue(" ]") << " "
+          << make_pretty(mode_set).tuple_separator(" | ").preamble("[ ")
+          .epilogue(" ]") << " "
+          << make_pretty(stencil_set).tuple_separator(" | ").preamble("[ ")
+          .epilogue(" ]") << " [ components ] [ rowAlign ]" << endl;
+      }
+    }
+
+    mpiSafeCall( MPI_Bcast( &validArgs, 1, MPI_INT, 0, MPI_COMM_WORLD ) );
+    if ( !validArgs ){
+      mpiSafeCall( MPI_Finalize() );
+      return (EXIT_FAILURE);
+    }
+
+    // Broadcast of test parameters
+    MPI_Bcast( &variant, 1, MPI_INT, 0, MPI_COMM_WORLD );
+    MPI_Bcast( &haloType, 1, MPI_INT, 0, MPI_COMM_WORLD );
+    MPI_Bcast( &engine, 1, MPI_INT, 0, MPI_COMM_WORLD );
+    MPI_Bcast( &haloMode, 1, MPI_INT, 0, MPI_COMM_WORLD );
+    MPI_Bcast( &stencil, 1, MPI_INT, 0, MPI_COMM_WORLD );
+    MPI_Bcast( &components, 1, MPI_INT, 0, MPI_COMM_WORLD );
+    MPI_Bcast( &rowAlign, 1, MPI_INT, 0, MPI_COMM_WORLD );
+
+    // tight halos are meant for non periodic grids
+    if ( haloType == HaloType::Tight )
+      periodicity = vector<int>( tileSplit.size(), 0 );
+
+    // aggregated engine: blocks of 1x2x2 nodes on a two level grid
+    vector<int> coreSplit = { 1, 2, 2 };
+    vector<int> nodeSplit = { 2, 1, 1 };
+    CartSplitter * splitter = engine == HaloEngine::Aggregated 
+      ? new CartSplitter( nodeSplit, coreSplit, periodicity, MPI_COMM_WORLD )
+      : new CartSplitter( tileSplit, periodicity, MPI_COMM_WORLD );
+    CartSplitter& cs = *splitter;
+    if ( engine == HaloEngine::Threaded )
+      cs.setHaloThreads( 4 );
+
+    if ( cs.inGrid() ){
+      int cartRank = cs.getRank();
+      int ROOT = 0;
+
+      vector<double> data;
+      if ( ROOT == cartRank ){
+        data = vector<double>( prod( dims ) * components );
+        for( unsigned int ii = 0; ii < data.size(); ++ii )
+          data[ii] = ii / components + 1 + 0.25 * ( ii % components );
+      }
+
+      DistributedDescription<double> * dd =
+        cs.createDistributedDescription<double>( dims, haloPre, haloPost, 
+            haloType, haloMode, stencil, components, rowAlign );
+      dd->setHaloEngine( engine );
+
+      vector<double> localData( dd->getLocalSize( ), 0 );
+      cs.scatter( data, localData, ROOT, dd );
+
+      // additional fields, scaled copies of data
+      const int Nfields = 3;
+      vector< vector<double> > moreData( Nfields - 1 );
+      vector< vector<double>* > fields( 1, &localData );
+      if ( variant == HaloVariant::Fields ){
+        for( int ff = 1; ff < Nfields; ++ff ){
+          vector<double> scaled( data );
+          for( unsigned int ii = 0; ii < scaled.size(); ++ii )
+            scaled[ii] += ff * ( ii / components + 1 );
+          moreData[ff-1] = vector<double>( dd->getLocalSize( ), 0 );
+          cs.scatter( scaled, moreData[ff-1], ROOT, dd );
+          fields.push_back( &moreData[ff-1] );
+        }
+      }
+
+      // internal elements visited by overlap kernel ( each once )
+      int errors = 0;
+
+      switch ( variant ){
+        case HaloVariant::Blocking:
+          cs.haloUpdate( localData, dd );
+          break;
+        case HaloVariant::Split:
+          {
+            HaloRequest request = cs.haloUpdateBegin( localData, dd );
+            cs.haloUpdateEnd( request );
+          }
+          break;
+        case HaloVariant::Plan:
+          {
+            HaloPlan * plan = cs.createHaloPlan( localData, dd );
+            // repeated exchanges on the same plan
+            for( int step = 0; step < 3; ++step )
+              plan->update();
+            delete plan;
+          }
+          break;
+        case HaloVariant::Fields:
+          cs.haloUpdate( fields, dd );
+          break;
+        case HaloVariant::Shared:
+          {
+            SharedHalo<double> * sh = cs.createSharedHalo( dd );
+            std::copy( localData.begin(), localData.end(), sh->data() );
+            sh->update();
+            std::copy( sh->data(), sh->data() + sh->size(), localData.begin() );
+            delete sh;
+          }
+          break;
+        case HaloVariant::Rma:
+          {
+            // rma outlives the description it was created from
+            DistributedDescription<double> * rmaDd = 
+              cs.createDistributedDescription<double>( dims, haloPre, haloPost, 
+                  haloType, haloMode, stencil, components, rowAlign );
+            RmaHalo * rma = cs.createRmaHalo( localData, rmaDd );
+            delete rmaDd;
+            for( int step = 0; step < 3; ++step )
+              rma->update();
+            delete rma;
+          }
+          break;
+        case HaloVariant::Overlap:
+          {
+            const vector<int>& localDims = dd->getLocalDims();
+            vector<int> visits( prod( localDims ), 0 );
+            cs.haloUpdateOverlap( localData, dd, 
+                [&visits, &localDims]( const LocalRegion& r ){
+                  visitRegion( r, localDims, [&visits]( int lin ){ ++visits[lin]; } );
+                } );
+            errors += checkVisits( visits, dd );
+          }
+          break;
+        case HaloVariant::Tiles:
+          {
+            // single element tiles on 4 threads, tiles reading halos first
+            cs.haloUpdate( localData, dd );
+            cs.setHaloThreads( 4 );
+            const vector<int>& localDims = dd->getLocalDims();
+            vector< std::atomic<int> > visits( prod( localDims ) );
+            for( unsigned int ii = 0; ii < visits.size(); ++ii )
+              visits[ii] = 0;
+            std::atomic<int> order( 0 ), lastBoundary( -1 ), firstInterior( 1 << 30 );
+            cs.parallelForInterior( dd, [&]( const LocalRegion& r ){
+                  int position = order++;
+                  if ( dd->readsHalos( r ) ){
+                    for( int prev = lastBoundary; prev < position
+                        && !lastBoundary.compare_exchange_weak( prev, position ); );
+                  }
+                  else {
+                    for( int prev = firstInterior; prev > position
+                        && !firstInterior.compare_exchange_weak( prev, position ); );
+                  }
+                  visitRegion( r, localDims, [&visits]( int lin ){ ++visits[lin]; } );
+                }, true, sizeof(double) );
+            errors += checkVisits( visits, dd ) + ( lastBoundary > firstInterior );
+          }
+          break;
+        case HaloVariant::Errors:
+          {
+            // moved request is completed once, through its new handle
+            HaloRequest first = cs.haloUpdateBegin( localData, dd );
+            HaloRequest moved( std::move( first ) );
+            errors += first.pending();
+            cs.haloUpdateEnd( moved );
+            errors += moved.pending();
+
+            // staging buffers serve one exchange at a time
+            if ( engine == HaloEngine::Packed || engine == HaloEngine::Aggregated 
+                || engine == HaloEngine::Threaded ){
+              HaloRequest busy = cs.haloUpdateBegin( localData, dd );
+              errors += missingThrow( [&]{ cs.haloUpdate( localData, dd ); } );
+              errors += missingThrow( [&]{ cs.haloUpdateBegin( localData, dd ); } );
+              cs.haloUpdateEnd( busy );
+              if ( engine != HaloEngine::Aggregated ){
+                HaloPlan * first = cs.createHaloPlan( localData, dd );
+                HaloPlan * second = cs.createHaloPlan( localData, dd );
+                first->start();
+                errors += missingThrow( [&]{ second->start(); } );
+                first->wait();
+                second->update();
+                delete second;
+                delete first;
+              }
+            }
+
+            // externally owned buffer, too short buffers are rejected
+            double * buffer = localData.data();
+            const size_t size = localData.size();
+            cs.haloUpdate( buffer, size, dd );
+            if ( engine != HaloEngine::Aggregated ){
+              HaloPlan * plan = cs.createHaloPlan( buffer, size, dd );
+              plan->update();
+              delete plan;
+            }
+            errors += missingThrow( [&]{ cs.haloUpdate( buffer, size - 1, dd ); } );
+            errors += missingThrow( [&]{ cs.haloUpdateBegin( buffer, size - 1, dd ); } );
+            errors += missingThrow( [&]{ delete cs.createHaloPlan( buffer, size - 1, dd ); } );
+            errors += missingThrow( [&]{ delete cs.createRmaHalo( buffer, size - 1, dd ); } );
+            errors += missingThrow( [&]{ 
+                cs.scatter( data.data(), data.size(), buffer, size - 1, ROOT, dd ); } );
+            errors += missingThrow( [&]{ 
+                cs.gather( buffer, size - 1, data.data(), data.size(), ROOT, dd ); } );
+
+            // misuse is rejected before any message is posted
+            DistributedDescription<double> * bad =
+              cs.createDistributedDescription<double>( dims, haloPre, haloPost, 
+                  haloType, HaloMode::Direct, stencil, components, rowAlign );
+            if ( cs.getCoreDims().empty() ){
+              bad->setHaloEngine( HaloEngine::Aggregated );
+              errors += missingThrow( [&]{ cs.haloUpdate( localData, bad ); } );
+              errors += missingThrow( [&]{ cs.haloUpdateBegin( localData, bad ); } );
+              errors += missingThrow( [&]{ delete cs.createHaloPlan( localData, bad ); } );
+            }
+            delete bad;
+
+            // no fields, nothing to exchange
+            vector< vector<double>* > noFields;
+            cs.haloUpdate( noFields, dd );
+            HaloPlan * empty = cs.createHaloPlan( noFields, dd );
+            empty->update();
+            delete empty;
+          }
+          break;
+      }
+
+      vector< vector<int> > subSizes, starts;
+      cs.evalDimsOffsets( dims, subSizes, starts );
+
+      for( unsigned int ff = 0; ff < fields.size(); ++ff )
+        errors += checkHalos( *fields[ff], dims, periodicity, starts[cartRank], 
+            stencil, dd, ff + 1 );
+      mpiSafeCall( MPI_Allreduce( &errors, &totalErrors, 1, MPI_INT, MPI_SUM,
+            cs.getCommunicator() ) );
+
+      if ( ROOT == cartRank )
+        cout << "Errors: " << totalErrors << endl;
+
+      delete dd;
+    }
+
+    delete splitter;
+    MPI_Barrier( MPI_COMM_WORLD );
+  }
+  catch ( exception &e){
+    cerr << "Error: " << e.what() << endl;
+    return (EXIT_FAILURE);
+  }
+
+  mpiSafeCall( MPI_Barrier( MPI_COMM_WORLD ) );
+  mpiSafeCall( MPI_Finalize() );
+  return ( totalErrors ? EXIT_FAILURE : EXIT_SUCCESS );
+}
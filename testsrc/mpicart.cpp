@@ -163,6 +163,15 @@ int main(int argc, char *argv[]){
       for( unsigned int ii = 0; it < it_end; ++ii, ++it )
         *it = cs.getRankByOffset( directions[ii] );
 
+      // ranks by offset must agree with MPI_Cart_rank
+      for( unsigned int ii = 0; ii < directions.size(); ++ii ){
+        if ( neighbours[ii] != cs.getRank( coords + directions[ii] ) 
+            || neighbours[ii] != cs.getDestNeighbours()[ii] )
+          throw runtime_error("destination neighbours differ from getRank()");
+        if ( cs.getSrcNeighbours()[ii] != cs.getRank( coords - directions[ii] ) )
+          throw runtime_error("source neighbours differ from getRank()");
+      }
+
       // print my neighbours
       for( int rank = 0; rank < cs.getSize(); ++rank ){
 
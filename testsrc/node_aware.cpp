@@ -0,0 +1,105 @@
+/**
+ * @file node_aware.cpp
+ * @author Riccardo Zanella
+ * @date 10/2026
+ *
+ * Contacts: riccardo.zanella@gmail.com
+ *
+ */
+
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include "mpi.h"
+
+#include "safecheck.hpp"
+#include "vector_helper.hpp"
+#include "CartSplitter.hpp"
+#include "check_helpers.hpp"
+
+using std::exception;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::vector;
+
+using namespace vector_helper;
+
+// node aware rank placement on a 3x3 grid ( np >= 9 ): shared memory
+// nodes hold compact blocks, keeping at least as many halo bytes on
+// node as default placement, and data round trips unchanged
+
+int main (int argc, char *argv[]){
+  int totalErrors = 0;
+  try{
+    mpiSafeCall( MPI_Init(&argc, &argv) );
+
+    vector<int> tileSplit = { 3, 3 };
+    vector<int> periodicity = { 0, 0 };
+    vector<int> dims = { 200, 150 };
+    int dh = 2;
+
+    // halo bytes staying on node with default placement
+    double plainFraction = 0;
+    {
+      CartSplitter plain( tileSplit, periodicity, MPI_COMM_WORLD );
+      if ( plain.inGrid() ){
+        DistributedDescription<double> * dd =
+          plain.createDistributedDescription<double>( dims, dh, dh, HaloType::Full );
+        plainFraction = plain.haloLocality( dd ).intraFraction();
+        delete dd;
+      }
+    }
+    mpiSafeCall( MPI_Bcast( &plainFraction, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD ) );
+
+    CartSplitter aware( tileSplit, periodicity, MPI_COMM_WORLD,
+        CartSplitter::NodeAware );
+
+    if ( aware.inGrid() ){
+      const int ROOT = 0;
+      const int cartRank = aware.getRank();
+
+      DistributedDescription<double> * dd =
+        aware.createDistributedDescription<double>( dims, dh, dh, HaloType::Full );
+
+      vector<double> data, dataBack;
+      if ( ROOT == cartRank ){
+        data = rowColumnData( dims );
+        dataBack = vector<double>( prod( dims ) );
+      }
+
+      vector<double> localData( dd->getLocalSize( ) );
+      aware.scatter( data, localData, ROOT, dd );
+      aware.haloUpdate( localData, dd );
+      aware.gather( localData, dataBack, ROOT, dd );
+
+      HaloLocality placed = aware.haloLocality( dd );
+
+      int errors = 0;
+      if ( ROOT == cartRank )
+        errors += ( placed.intraFraction() < plainFraction )
+          + countMismatches( data, dataBack );
+
+      mpiSafeCall( MPI_Allreduce( &errors, &totalErrors, 1, MPI_INT, MPI_SUM,
+            aware.getCommunicator() ) );
+      if ( ROOT == cartRank )
+        cout << "Errors: " << totalErrors
+          << " ( intra node halo bytes " << placed.intraFraction()
+          << ", default placement " << plainFraction << " )" << endl;
+
+      delete dd;
+    }
+
+    MPI_Barrier( MPI_COMM_WORLD );
+  }
+  catch ( exception &e){
+    cerr << "Error: " << e.what() << endl;
+    return (EXIT_FAILURE);
+  }
+
+  mpiSafeCall( MPI_Barrier( MPI_COMM_WORLD ) );
+  mpiSafeCall( MPI_Finalize() );
+  return ( totalErrors ? EXIT_FAILURE : EXIT_SUCCESS );
+}
@@ -0,0 +1,103 @@
+/**
+ * @file redistribute.cpp
+ * @author Riccardo Zanella
+ * @date 10/2026
+ *
+ * Contacts: riccardo.zanella@gmail.com
+ *
+ */
+
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+#include "mpi.h"
+
+#include "safecheck.hpp"
+#include "vector_helper.hpp"
+#include "CartSplitter.hpp"
+#include "check_helpers.hpp"
+
+using std::exception;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::vector;
+
+using namespace vector_helper;
+
+// redistribution on a 3x3 grid ( np >= 9 ): even blocks to cost
+// weighted blocks and back, without going through a root
+
+int main (int argc, char *argv[]){
+  int totalErrors = 0;
+  try{
+    mpiSafeCall( MPI_Init(&argc, &argv) );
+
+    vector<int> tileSplit = { 3, 3 };
+    vector<int> periodicity = { 0, 0 };
+    vector<int> dims = { 240, 150 };
+    int dh = 2;
+
+    CartSplitter cs( tileSplit, periodicity, MPI_COMM_WORLD );
+
+    if ( cs.inGrid() ){
+      const int ROOT = 0;
+      const int cartRank = cs.getRank();
+
+      vector< vector<double> > weights( 2 );
+      weights[0] = vector<double>( dims[0], 1.0 );
+      std::fill( weights[0].begin(), weights[0].begin() + dims[0] / 6, 10.0 );
+      weights[1] = vector<double>( dims[1], 1.0 );
+      std::fill( weights[1].end() - dims[1] / 4, weights[1].end(), 5.0 );
+
+      DistributedDescription<double> * even =
+        cs.createDistributedDescription<double>( dims, dh, dh, HaloType::Full );
+      DistributedDescription<double> * weighted =
+        cs.createDistributedDescription<double>( dims, weights,
+            vector<int>( 2, dh ), vector<int>( 2, dh ), HaloType::Full );
+
+      vector<double> data, dataBack;
+      if ( ROOT == cartRank ){
+        data = rowColumnData( dims );
+        dataBack = vector<double>( prod( dims ) );
+      }
+
+      vector<double> evenData( even->getLocalSize( ) );
+      vector<double> weightedData( weighted->getLocalSize( ) );
+      cs.scatter( data, evenData, ROOT, even );
+
+      int errors = 0;
+      cs.redistribute( evenData, even, weightedData, weighted );
+      cs.gather( weightedData, dataBack, ROOT, weighted );
+      if ( ROOT == cartRank )
+        errors += countMismatches( data, dataBack );
+
+      std::fill( evenData.begin(), evenData.end(), 0. );
+      cs.redistribute( weightedData, weighted, evenData, even );
+      cs.gather( evenData, dataBack, ROOT, even );
+      if ( ROOT == cartRank )
+        errors += countMismatches( data, dataBack );
+
+      mpiSafeCall( MPI_Allreduce( &errors, &totalErrors, 1, MPI_INT, MPI_SUM,
+            cs.getCommunicator() ) );
+      if ( ROOT == cartRank )
+        cout << "Errors: " << totalErrors << endl;
+
+      delete weighted;
+      delete even;
+    }
+
+    MPI_Barrier( MPI_COMM_WORLD );
+  }
+  catch ( exception &e){
+    cerr << "Error: " << e.what() << endl;
+    return (EXIT_FAILURE);
+  }
+
+  mpiSafeCall( MPI_Barrier( MPI_COMM_WORLD ) );
+  mpiSafeCall( MPI_Finalize() );
+  return ( totalErrors ? EXIT_FAILURE : EXIT_SUCCESS );
+}
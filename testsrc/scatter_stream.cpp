@@ -0,0 +1,99 @@
+/**
+ * @file scatter_stream.cpp
+ * @author Riccardo Zanella
+ * @date 10/2026
+ *
+ * Contacts: riccardo.zanella@gmail.com
+ *
+ */
+
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include "mpi.h"
+
+#include "safecheck.hpp"
+#include "vector_helper.hpp"
+#include "CartSplitter.hpp"
+#include "check_helpers.hpp"
+
+using std::exception;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::vector;
+
+using namespace vector_helper;
+
+// streaming scatter from a generator on a 3x3 grid ( np >= 9 ):
+// slabs not aligned to blocks, a single slab and one row slabs
+
+int main (int argc, char *argv[]){
+  int totalErrors = 0;
+  try{
+    mpiSafeCall( MPI_Init(&argc, &argv) );
+
+    vector<int> tileSplit = { 3, 3 };
+    vector<int> periodicity = { 0, 0 };
+    vector<int> dims = { 200, 150 };
+    int dh = 2;
+
+    CartSplitter cs( tileSplit, periodicity, MPI_COMM_WORLD );
+
+    if ( cs.inGrid() ){
+      const int ROOT = 4;
+      const int cartRank = cs.getRank();
+
+      DistributedDescription<double> * dd =
+        cs.createDistributedDescription<double>( dims, dh, dh, HaloType::Full );
+
+      vector<double> data, dataBack;
+      if ( ROOT == cartRank ){
+        data = rowColumnData( dims );
+        dataBack = vector<double>( prod( dims ) );
+      }
+
+      const int cols = dims[1];
+      int errors = 0;
+      const int slabRows[] = { 7, 1000, 1 };
+      for( int ss = 0; ss < 3; ++ss ){
+        vector<double> localData( dd->getLocalSize( ) );
+        cs.scatterStream( [cols]( int first, int count, double * slab ){
+            for( int r = first; r < first + count; ++r )
+              for( int c = 0; c < cols; ++c )
+                slab[ ( r - first ) * cols + c ] = 100*(r+1) + c;
+            }, localData, ROOT, dd, slabRows[ss] );
+        cs.gather( localData, dataBack, ROOT, dd );
+
+        if ( ROOT == cartRank )
+          errors += countMismatches( data, dataBack );
+      }
+
+      // slabs must hold at least a row
+      vector<double> localData( dd->getLocalSize( ) );
+      try {
+        cs.scatterStream( []( int, int, double * ){}, localData, ROOT, dd, 0 );
+        ++errors;
+      } catch ( exception& ){}
+
+      mpiSafeCall( MPI_Allreduce( &errors, &totalErrors, 1, MPI_INT, MPI_SUM,
+            cs.getCommunicator() ) );
+      if ( ROOT == cartRank )
+        cout << "Errors: " << totalErrors << endl;
+
+      delete dd;
+    }
+
+    MPI_Barrier( MPI_COMM_WORLD );
+  }
+  catch ( exception &e){
+    cerr << "Error: " << e.what() << endl;
+    return (EXIT_FAILURE);
+  }
+
+  mpiSafeCall( MPI_Barrier( MPI_COMM_WORLD ) );
+  mpiSafeCall( MPI_Finalize() );
+  return ( totalErrors ? EXIT_FAILURE : EXIT_SUCCESS );
+}
@@ -0,0 +1,110 @@
+/**
+ * @file weighted_split.cpp
+ * @author Riccardo Zanella
+ * @date 10/2026
+ *
+ * Contacts: riccardo.zanella@gmail.com
+ *
+ */
+
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+#include "mpi.h"
+
+#include "safecheck.hpp"
+#include "vector_helper.hpp"
+#include "CartSplitter.hpp"
+#include "check_helpers.hpp"
+
+using std::exception;
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::vector;
+
+using namespace vector_helper;
+
+// cost weighted decomposition on a 3x3 grid ( np >= 9 ): rows near
+// first boundary cost ten times more, no cost at all on columns
+
+int main (int argc, char *argv[]){
+  int totalErrors = 0;
+  try{
+    mpiSafeCall( MPI_Init(&argc, &argv) );
+
+    vector<int> tileSplit = { 3, 3 };
+    vector<int> periodicity = { 0, 0 };
+    vector<int> dims = { 240, 150 };
+    int dh = 2;
+
+    CartSplitter cs( tileSplit, periodicity, MPI_COMM_WORLD );
+
+    if ( cs.inGrid() ){
+      const int ROOT = 0;
+      const int cartRank = cs.getRank();
+      MPI_Comm comm = cs.getCommunicator();
+
+      vector< vector<double> > weights( 2 );
+      weights[0] = vector<double>( dims[0], 1.0 );
+      std::fill( weights[0].begin(), weights[0].begin() + dims[0] / 6, 10.0 );
+      weights[1] = vector<double>( dims[1], 0.0 );
+
+      DistributedDescription<double> * weighted =
+        cs.createDistributedDescription<double>( dims, weights,
+            vector<int>( 2, dh ), vector<int>( 2, dh ), HaloType::Full );
+
+      vector<double> data, dataBack;
+      if ( ROOT == cartRank ){
+        data = rowColumnData( dims );
+        dataBack = vector<double>( prod( dims ) );
+      }
+
+      vector<double> weightedData( weighted->getLocalSize( ) );
+      cs.scatter( data, weightedData, ROOT, weighted );
+      cs.haloUpdate( weightedData, weighted );
+      cs.gather( weightedData, dataBack, ROOT, weighted );
+
+      // cost of each block row must match ( up to a row )
+      vector< vector<int> > subSizes, starts;
+      cs.evalDimsOffsets( dims, weights, subSizes, starts );
+      double cost = 0, maxCost, minCost;
+      for( int r = starts[cartRank][0]; r < starts[cartRank][0] + subSizes[cartRank][0]; ++r )
+        cost += weights[0][r];
+      mpiSafeCall( MPI_Allreduce( &cost, &maxCost, 1, MPI_DOUBLE, MPI_MAX, comm ) );
+      mpiSafeCall( MPI_Allreduce( &cost, &minCost, 1, MPI_DOUBLE, MPI_MIN, comm ) );
+
+      // zero weights split as unweighted
+      vector< vector<int> > evenSizes, evenStarts;
+      cs.evalDimsOffsets( dims, evenSizes, evenStarts );
+
+      int errors = 0;
+      if ( ROOT == cartRank ){
+        errors += ( maxCost - minCost > 10.0 );
+        for( unsigned int rr = 0; rr < subSizes.size(); ++rr )
+          errors += ( subSizes[rr][1] != evenSizes[rr][1] );
+        errors += countMismatches( data, dataBack );
+      }
+
+      mpiSafeCall( MPI_Allreduce( &errors, &totalErrors, 1, MPI_INT, MPI_SUM,
+            comm ) );
+      if ( ROOT == cartRank )
+        cout << "Errors: " << totalErrors << endl;
+
+      delete weighted;
+    }
+
+    MPI_Barrier( MPI_COMM_WORLD );
+  }
+  catch ( exception &e){
+    cerr << "Error: " << e.what() << endl;
+    return (EXIT_FAILURE);
+  }
+
+  mpiSafeCall( MPI_Barrier( MPI_COMM_WORLD ) );
+  mpiSafeCall( MPI_Finalize() );
+  return ( totalErrors ? EXIT_FAILURE : EXIT_SUCCESS );
+}